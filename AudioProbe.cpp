@@ -0,0 +1,308 @@
+#include "AudioProbe.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QtEndian>
+
+namespace
+{
+	const QByteArrayView riffMagic("RIFF");
+	const QByteArrayView waveMagic("WAVE");
+	const QByteArrayView id3Magic("ID3");
+	const QByteArrayView oggMagic("OggS");
+
+	quint16 readLe16(QByteArrayView data, qsizetype pos)
+	{
+		return qFromLittleEndian<quint16>(data.data() + pos);
+	}
+
+	quint32 readLe32(QByteArrayView data, qsizetype pos)
+	{
+		return qFromLittleEndian<quint32>(data.data() + pos);
+	}
+
+	quint32 readBe32(QByteArrayView data, qsizetype pos)
+	{
+		return qFromBigEndian<quint32>(data.data() + pos);
+	}
+
+	AudioProbe::Codec codecFromFormatTag(quint16 formatTag)
+	{
+		switch (formatTag)
+		{
+		case 0x0001: return AudioProbe::Pcm;
+		case 0x0002:
+		case 0x0011:
+		case 0x0069: return AudioProbe::Adpcm;
+		case 0x0055: return AudioProbe::Mp3;
+		case 0x0165:
+		case 0x0166: return AudioProbe::Xma;
+		case 0x3039:
+		case 0x3040:
+		case 0x3041: return AudioProbe::Opus;
+		case 0xFFFF: return AudioProbe::Vorbis;
+		default: return AudioProbe::UnknownCodec;
+		}
+	}
+}
+
+AudioProbe::Info AudioProbe::probe(QByteArrayView header, qint64 fileSize)
+{
+	if (header.startsWith(riffMagic))
+	{
+		return probeRiff(header, fileSize);
+	}
+	if (header.startsWith(oggMagic))
+	{
+		return probeOgg(header);
+	}
+	const qint64 tagSize = id3Size(header);
+	if (tagSize < header.size())
+	{
+		return probeMpeg(header.sliced(tagSize), fileSize - tagSize);
+	}
+	// Tag ID3 plus long que l'en-tête lu : probeFile relit plus loin.
+	// Un fichier vide ou illisible n'a pas de tag, il reste inconnu
+	Info result;
+	result.codec = header.startsWith(id3Magic) ? Mp3 : UnknownCodec;
+	return result;
+}
+
+AudioProbe::Info AudioProbe::probeFile(const QString& filePath)
+{
+	QFile file(filePath);
+	if (!file.open(QFile::ReadOnly))
+	{
+		return Info();
+	}
+	const qint64 fileSize = file.size();
+	const QByteArray header = file.read(headerSize);
+	const qint64 tagSize = id3Size(header);
+	if (header.startsWith(id3Magic) && tagSize >= header.size() && tagSize < fileSize && file.seek(tagSize))
+	{
+		// Pochette ou paroles dans le tag : une seule lecture de plus, juste après
+		return probeMpeg(file.read(headerSize), fileSize - tagSize);
+	}
+	return probe(header, fileSize);
+}
+
+AudioProbe::Info AudioProbe::probeRiff(QByteArrayView header, qint64 fileSize)
+{
+	Info result;
+	if (header.size() < 12 || header.sliced(8, 4) != waveMagic)
+	{
+		return result;
+	}
+
+	quint32 avgBytesPerSecond = 0;
+	quint32 sampleCount = 0;
+	qint64 dataSize = -1;
+	qsizetype pos = 12;
+	while (pos + 8 <= header.size())
+	{
+		const QByteArrayView chunkId = header.sliced(pos, 4);
+		const quint32 chunkSize = readLe32(header, pos + 4);
+		const qsizetype body = pos + 8;
+		if (chunkId == "fmt " && body + 16 <= header.size())
+		{
+			quint16 formatTag = readLe16(header, body);
+			result.channels = quint8(readLe16(header, body + 2));
+			result.sampleRate = readLe32(header, body + 4);
+			avgBytesPerSecond = readLe32(header, body + 8);
+			// WAVE_FORMAT_EXTENSIBLE : le vrai format est au début du GUID
+			if (formatTag == 0xFFFE && chunkSize >= 0x1A && body + 0x1A <= header.size())
+			{
+				formatTag = readLe16(header, body + 0x18);
+			}
+			result.codec = codecFromFormatTag(formatTag);
+			// Vorbis et Opus de Wwise : nombre d'échantillons juste après l'en-tête étendu
+			if ((result.codec == Vorbis || result.codec == Opus) && chunkSize >= 0x1C && body + 0x1C <= header.size())
+			{
+				sampleCount = readLe32(header, body + 0x18);
+			}
+		}
+		else if (chunkId == "data")
+		{
+			dataSize = chunkSize;
+			break;
+		}
+		pos = body + chunkSize + (chunkSize & 1);
+	}
+
+	if (sampleCount > 0 && result.sampleRate > 0)
+	{
+		result.durationMs = quint32(quint64(sampleCount) * 1000 / result.sampleRate);
+	}
+	else if (avgBytesPerSecond > 0)
+	{
+		const qint64 audioSize = dataSize >= 0 ? dataSize : fileSize - pos;
+		result.durationMs = quint32(qMax<qint64>(audioSize, 0) * 1000 / avgBytesPerSecond);
+	}
+	return result;
+}
+
+AudioProbe::Info AudioProbe::probeMpeg(QByteArrayView header, qint64 audioSize)
+{
+	static const quint16 mpeg1Bitrates[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 };
+	static const quint16 mpeg2Bitrates[] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 };
+	static const quint32 mpeg1SampleRates[] = { 44100, 48000, 32000, 0 };
+
+	Info result;
+	// Première trame valide dans la fenêtre lue
+	for (qsizetype pos = 0; pos + 4 <= header.size(); pos++)
+	{
+		const quint32 frameHeader = readBe32(header, pos);
+		if ((frameHeader & 0xFFE00000) != 0xFFE00000)
+		{
+			continue;
+		}
+		const quint32 version = (frameHeader >> 19) & 3;
+		const quint32 layer = (frameHeader >> 17) & 3;
+		const quint32 bitrateIndex = (frameHeader >> 12) & 15;
+		const quint32 sampleRateIndex = (frameHeader >> 10) & 3;
+		if (version == 1 || layer == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+		{
+			continue;
+		}
+
+		const bool mpeg1 = version == 3;
+		const bool mono = ((frameHeader >> 6) & 3) == 3;
+		result.codec = Mp3;
+		result.channels = mono ? 1 : 2;
+		result.sampleRate = mpeg1SampleRates[sampleRateIndex] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+		// Seule la couche III (les VF) a sa durée estimée
+		if (layer != 1)
+		{
+			return result;
+		}
+
+		// En-tête Xing/Info d'un MP3 à débit variable : nombre exact de trames
+		const qsizetype sideInfo = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+		const qsizetype xing = pos + 4 + sideInfo;
+		const quint32 samplesPerFrame = mpeg1 ? 1152 : 576;
+		if (xing + 12 <= header.size() && (header.sliced(xing, 4) == "Xing" || header.sliced(xing, 4) == "Info")
+			&& (readBe32(header, xing + 4) & 1))
+		{
+			result.durationMs = quint32(quint64(readBe32(header, xing + 8)) * samplesPerFrame * 1000 / result.sampleRate);
+			return result;
+		}
+
+		const quint32 bitrate = (mpeg1 ? mpeg1Bitrates : mpeg2Bitrates)[bitrateIndex] * 1000;
+		if (bitrate > 0)
+		{
+			result.durationMs = quint32(qMax<qint64>(audioSize - pos, 0) * 8 * 1000 / bitrate);
+		}
+		return result;
+	}
+	return result;
+}
+
+AudioProbe::Info AudioProbe::probeOgg(QByteArrayView header)
+{
+	// Le premier paquet suit l'en-tête de page (27 octets) et sa table de segments
+	Info result;
+	if (header.size() < 27)
+	{
+		return result;
+	}
+	const qsizetype packet = 27 + quint8(header[26]);
+	if (packet + 16 <= header.size() && header.sliced(packet, 7) == "\x01vorbis")
+	{
+		result.codec = OggVorbis;
+		result.channels = quint8(header[packet + 11]);
+		result.sampleRate = readLe32(header, packet + 12);
+	}
+	else if (packet + 16 <= header.size() && header.sliced(packet, 8) == "OpusHead")
+	{
+		result.codec = OggOpus;
+		result.channels = quint8(header[packet + 9]);
+		result.sampleRate = 48000;
+	}
+	return result;
+}
+
+qint64 AudioProbe::id3Size(QByteArrayView header)
+{
+	if (header.size() < 10 || !header.startsWith(id3Magic))
+	{
+		return 0;
+	}
+	// Taille "synchsafe" : 7 bits utiles par octet, plus le pied de tag s'il est annoncé
+	const qint64 size = (qint64(header[6] & 0x7F) << 21) | (qint64(header[7] & 0x7F) << 14)
+		| (qint64(header[8] & 0x7F) << 7) | qint64(header[9] & 0x7F);
+	return 10 + size + ((header[5] & 0x10) ? 10 : 0);
+}
+
+QString AudioProbe::codecName(Codec codec)
+{
+	switch (codec)
+	{
+	case UnknownCodec: return "UNKNOWN";
+	case Pcm: return "PCM";
+	case Adpcm: return "ADPCM";
+	case Vorbis: return "VORBIS";
+	case Opus: return "OPUS";
+	case Xma: return "XMA";
+	case Mp3: return "MP3";
+	case OggVorbis: return "OGG_VORBIS";
+	case OggOpus: return "OGG_OPUS";
+	case CodecCount: break;
+	}
+	return QString();
+}
+
+AudioProbe::Codec AudioProbe::codecFromName(const QString& name)
+{
+	for (int i = 0; i < CodecCount; i++)
+	{
+		if (codecName(Codec(i)) == name)
+		{
+			return Codec(i);
+		}
+	}
+	return UnknownCodec;
+}
+
+bool AudioProbe::isCompatible(const QString& expectedCodec, Codec codec)
+{
+	if (expectedCodec == "PCM" || expectedCodec == "PCMEX")
+	{
+		return codec == Pcm;
+	}
+	if (expectedCodec == "ADPCM" || expectedCodec == "WIIADPCM")
+	{
+		return codec == Adpcm;
+	}
+	if (expectedCodec == "VORBIS")
+	{
+		return codec == Vorbis;
+	}
+	if (expectedCodec == "OPUS" || expectedCodec == "OPUS_WEM" || expectedCodec == "OPUSNX")
+	{
+		return codec == Opus;
+	}
+	if (expectedCodec == "XMA")
+	{
+		return codec == Xma;
+	}
+	return true;
+}
+
+QString AudioProbe::toText(const Info& info)
+{
+	return codecName(info.codec) + ";" + QString::number(info.sampleRate) + ";" + QString::number(info.channels) + ";" + QString::number(info.durationMs);
+}
+
+AudioProbe::Info AudioProbe::fromText(const QString& text)
+{
+	Info result;
+	const QStringList parts = text.split(';');
+	if (parts.size() == 4)
+	{
+		result.codec = codecFromName(parts[0]);
+		result.sampleRate = parts[1].toUInt();
+		result.channels = quint8(parts[2].toUInt());
+		result.durationMs = parts[3].toUInt();
+	}
+	return result;
+}
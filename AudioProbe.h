@@ -0,0 +1,60 @@
+#ifndef AUDIOPROBE_H
+#define AUDIOPROBE_H
+
+#include <QByteArrayView>
+#include <QString>
+
+// Identification d'un fichier audio à partir de ses premiers octets seulement :
+// WEM/RIFF (PCM, ADPCM, Vorbis, Opus, XMA), MP3 (avec en-tête Xing/Info si présent)
+// et Ogg. Donne le codec, la fréquence, le nombre de canaux et la durée quand l'en-tête
+// la contient ou permet de l'estimer.
+class AudioProbe
+{
+public:
+	enum Codec : quint8
+	{
+		UnknownCodec,
+		Pcm,
+		Adpcm,
+		Vorbis,
+		Opus,
+		Xma,
+		Mp3,
+		OggVorbis,
+		OggOpus,
+		CodecCount
+	};
+
+	struct Info
+	{
+		Codec codec = UnknownCodec;
+		quint8 channels = 0;
+		quint32 sampleRate = 0;
+		// 0 si inconnue
+		quint32 durationMs = 0;
+	};
+
+	static constexpr qsizetype headerSize = 512;
+
+	static Info probe(QByteArrayView header, qint64 fileSize);
+	// Lit au plus deux fois headerSize octets (une de plus si un tag ID3 précède le MP3)
+	static Info probeFile(const QString& filePath);
+
+	static QString codecName(Codec codec);
+	static Codec codecFromName(const QString& name);
+	// Codec Wwise attendu par le txtp ("VORBIS", "OPUS_WEM", ...) : la VF peut-elle le remplacer ?
+	// Un codec attendu inconnu ou non vérifiable est toujours accepté
+	static bool isCompatible(const QString& expectedCodec, Codec codec);
+
+	// "VORBIS;48000;1;3250" : forme stockée dans le cache d'analyse
+	static QString toText(const Info& info);
+	static Info fromText(const QString& text);
+
+private:
+	static Info probeRiff(QByteArrayView header, qint64 fileSize);
+	static Info probeMpeg(QByteArrayView header, qint64 audioSize);
+	static Info probeOgg(QByteArrayView header);
+	static qint64 id3Size(QByteArrayView header);
+};
+
+#endif // AUDIOPROBE_H
@@ -0,0 +1,196 @@
+#include "CopyJournal.h"
+
+#include <QMutexLocker>
+#include <QtEndian>
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <io.h>
+#include <windows.h>
+#endif
+
+namespace
+{
+	const QString journalFileName = "OblivionFrenchiser.journal";
+	const QByteArray journalMagic = "OFJ1";
+	// Magie puis clé SHA-1 du plan : les enregistrements qui suivent restent alignés sur 4 octets
+	const qint64 headerSize = 4 + 20;
+	// Ids par écriture du journal : une synchronisation des sorties, du dossier et du journal par lot
+	const int journalBatchSize = 256;
+#if defined(Q_OS_WIN)
+	// FlushFileBuffers demande un accès en écriture
+	const QIODevice::OpenMode syncOpenMode = QFile::ReadWrite;
+#else
+	// Une sortie liée en dur à une VF en lecture seule se synchronise quand même
+	const QIODevice::OpenMode syncOpenMode = QFile::ReadOnly;
+#endif
+}
+
+QString CopyJournal::journalPath(const QString& outputFolder)
+{
+	return outputFolder + "/" + journalFileName;
+}
+
+bool CopyJournal::exists(const QString& outputFolder)
+{
+	return QFile::exists(journalPath(outputFolder));
+}
+
+bool CopyJournal::syncFile(QFile& file)
+{
+	file.flush();
+#if defined(Q_OS_UNIX)
+	return ::fsync(file.handle()) == 0;
+#elif defined(Q_OS_WIN)
+	return FlushFileBuffers(HANDLE(_get_osfhandle(file.handle()))) != 0;
+#else
+	return true;
+#endif
+}
+
+bool CopyJournal::load(const QString& outputFolder, const QByteArray& planKey)
+{
+	committedIds.clear();
+	QFile journal(journalPath(outputFolder));
+	if (!journal.open(QFile::ReadOnly))
+	{
+		return false;
+	}
+	const QByteArray content = journal.readAll();
+	if (content.size() < headerSize || !content.startsWith(journalMagic) || content.mid(journalMagic.size(), planKey.size()) != planKey)
+	{
+		return false;
+	}
+
+	// Un dernier enregistrement incomplet (arrêt pendant l'écriture) est ignoré
+	const qsizetype recordCount = (content.size() - headerSize) / 4;
+	committedIds.reserve(recordCount);
+	for (qsizetype i = 0; i < recordCount; i++)
+	{
+		committedIds.insert(qFromLittleEndian<quint32>(content.constData() + headerSize + i * 4));
+	}
+	return true;
+}
+
+bool CopyJournal::open(const QString& outputFolder, const QByteArray& planKey, bool resume)
+{
+	if (file.isOpen())
+	{
+		file.close();
+	}
+	if (!resume)
+	{
+		committedIds.clear();
+	}
+	pendingIds.clear();
+	pendingPaths.clear();
+	this->outputFolder = outputFolder;
+	file.setFileName(journalPath(outputFolder));
+	// Sans tampon : chaque id est dans le fichier dès append(), même si le programme s'arrête net
+	if (resume)
+	{
+		if (!file.open(QFile::ReadWrite | QFile::Unbuffered))
+		{
+			return false;
+		}
+		file.resize(headerSize + (file.size() - headerSize) / 4 * 4);
+		return file.seek(file.size());
+	}
+	if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Unbuffered))
+	{
+		return false;
+	}
+	return file.write(journalMagic + planKey) == headerSize && syncFile(file);
+}
+
+void CopyJournal::append(quint32 id, const QString& outputPath)
+{
+	QList<quint32> ids;
+	QStringList outputPaths;
+	{
+		QMutexLocker locker(&fileMutex);
+		pendingIds.append(id);
+		pendingPaths.append(outputPath);
+		if (pendingIds.size() < journalBatchSize)
+		{
+			return;
+		}
+		ids.swap(pendingIds);
+		outputPaths.swap(pendingPaths);
+	}
+	// Hors du verrou : les autres threads continuent de copier pendant les synchronisations
+	flush(ids, outputPaths);
+}
+
+void CopyJournal::close()
+{
+	// Appelé une fois toutes les copies terminées : plus aucun lot en cours
+	flush(pendingIds, pendingPaths);
+	pendingIds.clear();
+	pendingPaths.clear();
+	if (file.isOpen())
+	{
+		file.close();
+	}
+	committedIds.clear();
+}
+
+void CopyJournal::remove()
+{
+	pendingIds.clear();
+	pendingPaths.clear();
+	close();
+	file.remove();
+}
+
+void CopyJournal::flush(const QList<quint32>& ids, const QStringList& outputPaths)
+{
+	if (ids.isEmpty() || !file.isOpen())
+	{
+		return;
+	}
+	// Contenu des sorties puis renommages du lot : le journal ne doit jamais devancer le disque.
+	// Une sortie qui ne peut être synchronisée n'est pas notée, elle sera revérifiée
+	QList<quint32> syncedIds;
+	syncedIds.reserve(ids.size());
+	for (qsizetype i = 0; i < ids.size(); i++)
+	{
+		QFile output(outputPaths[i]);
+		if (output.open(syncOpenMode) && syncFile(output))
+		{
+			syncedIds.append(ids[i]);
+		}
+	}
+	if (syncedIds.isEmpty() || !syncFolder())
+	{
+		return;
+	}
+
+	QByteArray records(syncedIds.size() * 4, Qt::Uninitialized);
+	for (qsizetype i = 0; i < syncedIds.size(); i++)
+	{
+		qToLittleEndian(syncedIds[i], records.data() + i * 4);
+	}
+	QMutexLocker locker(&fileMutex);
+	file.write(records);
+	syncFile(file);
+}
+
+bool CopyJournal::syncFolder() const
+{
+#if defined(Q_OS_UNIX)
+	const int folder = ::open(QFile::encodeName(outputFolder).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (folder < 0)
+	{
+		return false;
+	}
+	const bool synced = ::fsync(folder) == 0;
+	::close(folder);
+	return synced;
+#else
+	// Pas de synchronisation d'un dossier sous Windows : NTFS journalise déjà ses renommages
+	return true;
+#endif
+}
@@ -0,0 +1,59 @@
+#ifndef COPYJOURNAL_H
+#define COPYJOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// Journal de l'étape de copie, dans le dossier de sortie : une clé du plan en en-tête, puis
+// l'id de chaque <id>.wem écrit et renommé (4 octets, ajoutés à la suite). Les ids sont
+// notés par lots, une fois le contenu des sorties du lot, les renommages du dossier et le
+// journal lui-même sur le disque : même après une coupure de courant, un id du journal
+// désigne une sortie complète, sans synchroniser chaque fichier au moment de sa copie.
+// Supprimé à la fin d'une copie complète : s'il est encore là au lancement suivant, la copie
+// a été interrompue, et si la clé est la même, les ids qu'il contient n'ont pas à être refaits.
+// Un enregistrement coupé par un arrêt brutal est ignoré, la sortie est simplement revérifiée.
+class CopyJournal
+{
+public:
+	static QString journalPath(const QString& outputFolder);
+	static bool exists(const QString& outputFolder);
+	// Attend que le contenu du fichier ouvert soit écrit sur le disque
+	static bool syncFile(QFile& file);
+
+	// Relit le journal d'une copie interrompue ; false s'il n'y en a pas ou si la clé diffère
+	bool load(const QString& outputFolder, const QByteArray& planKey);
+	qsizetype size() const { return committedIds.size(); }
+	// Lecture seule pendant la copie
+	bool contains(quint32 id) const { return committedIds.contains(id); }
+
+	// Sans resume, repart d'un journal vide
+	bool open(const QString& outputFolder, const QByteArray& planKey, bool resume);
+	bool isOpen() const { return file.isOpen(); }
+	// Depuis n'importe quel thread de copie, une fois outputPath renommé ; écrit au plus tard
+	// au prochain lot ou à close()
+	void append(quint32 id, const QString& outputPath);
+	// Copie interrompue : le dernier lot est écrit et le fichier reste pour la reprise,
+	// les ids relus sont oubliés
+	void close();
+	// Copie terminée : le journal n'a plus d'utilité
+	void remove();
+
+private:
+	// Synchronise les sorties du lot et le dossier, puis y note leurs ids
+	void flush(const QList<quint32>& ids, const QStringList& outputPaths);
+	bool syncFolder() const;
+
+	QSet<quint32> committedIds;
+	QMutex fileMutex;
+	QFile file;
+	QString outputFolder;
+	QList<quint32> pendingIds;
+	QStringList pendingPaths;
+};
+
+#endif // COPYJOURNAL_H
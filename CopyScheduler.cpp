@@ -0,0 +1,135 @@
+#include "CopyScheduler.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+namespace
+{
+	// Assez long pour lisser le débit de petits fichiers, assez court pour converger en quelques secondes
+	const int windowMs = 250;
+}
+
+CopyScheduler::CopyScheduler(int concurrency)
+	: concurrency(qMax(0, concurrency))
+{
+}
+
+int CopyScheduler::adaptiveMaxThreads()
+{
+	return qBound(4, QThread::idealThreadCount() * 4, 64);
+}
+
+CopyScheduler::Stats CopyScheduler::run(qsizetype count, const Job& job, const std::atomic<bool>& canceled)
+{
+	Stats stats;
+	nextItem = 0;
+	doneItems = 0;
+	doneBytes = 0;
+	if (count <= 0)
+	{
+		return stats;
+	}
+
+	const int workerCount = int(qMin<qsizetype>(concurrency > 0 ? concurrency : adaptiveMaxThreads(), count));
+	const int initialThreads = concurrency > 0 ? workerCount : qMin(workerCount, qMax(1, QThread::idealThreadCount()));
+	stats.initialThreads = initialThreads;
+	stats.minThreads = initialThreads;
+	stats.maxThreads = initialThreads;
+	setLimit(initialThreads);
+
+	QElapsedTimer timer;
+	timer.start();
+	pool.setMaxThreadCount(workerCount);
+	for (int workerIndex = 0; workerIndex < workerCount; workerIndex++)
+	{
+		pool.start(
+			[this, workerIndex, count, &job, &canceled]()
+			{
+				runWorker(workerIndex, count, job, canceled);
+			}
+		);
+	}
+
+	// Ce thread ne copie pas : il mesure chaque fenêtre et déplace la limite
+	int direction = 1;
+	double previousMbPerSecond = -1.0;
+	qint64 previousBytes = 0;
+	qint64 previousMs = 0;
+	while (!pool.waitForDone(windowMs))
+	{
+		const qint64 elapsedMs = timer.elapsed();
+		const qint64 bytes = doneBytes.load();
+		const double mbPerSecond = double(bytes - previousBytes) / (1024.0 * 1024.0) / (double(qMax<qint64>(elapsedMs - previousMs, 1)) / 1000.0);
+		previousBytes = bytes;
+		previousMs = elapsedMs;
+		const int currentLimit = limit.load();
+		if (mbPerSecond > stats.bestMbPerSecond)
+		{
+			stats.bestMbPerSecond = mbPerSecond;
+			stats.bestThreads = currentLimit;
+		}
+		if (concurrency > 0)
+		{
+			continue;
+		}
+
+		if (previousMbPerSecond >= 0.0 && mbPerSecond < previousMbPerSecond)
+		{
+			direction = -direction;
+		}
+		previousMbPerSecond = mbPerSecond;
+		const int nextLimit = qBound(1, currentLimit + direction * qMax(1, currentLimit / 4), workerCount);
+		setLimit(nextLimit);
+		stats.minThreads = qMin(stats.minThreads, nextLimit);
+		stats.maxThreads = qMax(stats.maxThreads, nextLimit);
+	}
+
+	stats.finalThreads = limit.load();
+	stats.items = doneItems.load();
+	stats.bytes = doneBytes.load();
+	stats.wallMs = timer.elapsed();
+	if (stats.bestThreads == 0 && stats.wallMs > 0)
+	{
+		// Terminé avant la première fenêtre
+		stats.bestMbPerSecond = double(stats.bytes) / (1024.0 * 1024.0) / (double(stats.wallMs) / 1000.0);
+		stats.bestThreads = initialThreads;
+	}
+	return stats;
+}
+
+void CopyScheduler::runWorker(int workerIndex, qsizetype count, const Job& job, const std::atomic<bool>& canceled)
+{
+	for (;;)
+	{
+		if (canceled || nextItem.load() >= count)
+		{
+			return;
+		}
+		if (workerIndex >= limit.load())
+		{
+			QMutexLocker locker(&limitMutex);
+			if (workerIndex >= limit.load())
+			{
+				limitRaised.wait(&limitMutex, windowMs);
+			}
+			continue;
+		}
+
+		const qsizetype index = nextItem.fetch_add(1);
+		if (index >= count)
+		{
+			return;
+		}
+		doneBytes += job(index);
+		doneItems++;
+	}
+}
+
+void CopyScheduler::setLimit(int limit)
+{
+	{
+		QMutexLocker locker(&limitMutex);
+		this->limit = limit;
+	}
+	limitRaised.wakeAll();
+}
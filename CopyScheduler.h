@@ -0,0 +1,61 @@
+#ifndef COPYSCHEDULER_H
+#define COPYSCHEDULER_H
+
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <functional>
+
+// Pool de threads réservé à l'étape de copie, plutôt que le pool global dimensionné sur les cœurs :
+// les éléments sont pris dans l'ordre donné (l'appelant les trie par emplacement sur le disque)
+// par au plus "limite" threads à la fois. En adaptatif, la limite part du nombre de cœurs et
+// suit le débit mesuré à chaque fenêtre : elle continue dans le même sens tant que le débit
+// progresse, repart dans l'autre sinon. Un disque mécanique finit avec peu d'écritures
+// simultanées, un NVMe avec beaucoup.
+class CopyScheduler
+{
+public:
+	struct Stats
+	{
+		int initialThreads = 0;
+		int minThreads = 0;
+		int maxThreads = 0;
+		int finalThreads = 0;
+		qint64 items = 0;
+		qint64 bytes = 0;
+		qint64 wallMs = 0;
+		// Débit de la meilleure fenêtre, et nombre de threads à ce moment
+		double bestMbPerSecond = 0.0;
+		int bestThreads = 0;
+	};
+
+	// Fonction d'un élément : renvoie le nombre d'octets traités, pour la mesure du débit
+	using Job = std::function<qint64(qsizetype index)>;
+
+	// 0 : adaptatif
+	explicit CopyScheduler(int concurrency = 0);
+
+	static int adaptiveMaxThreads();
+
+	// Bloquant ; s'arrête entre deux éléments si canceled passe à true
+	Stats run(qsizetype count, const Job& job, const std::atomic<bool>& canceled);
+
+private:
+	void runWorker(int workerIndex, qsizetype count, const Job& job, const std::atomic<bool>& canceled);
+	void setLimit(int limit);
+
+	const int concurrency;
+	QThreadPool pool;
+
+	std::atomic<qsizetype> nextItem { 0 };
+	std::atomic<qint64> doneItems { 0 };
+	std::atomic<qint64> doneBytes { 0 };
+	// Les threads au-delà de la limite attendent qu'elle remonte
+	std::atomic<int> limit { 1 };
+	QMutex limitMutex;
+	QWaitCondition limitRaised;
+};
+
+#endif // COPYSCHEDULER_H
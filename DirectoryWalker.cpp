@@ -0,0 +1,289 @@
+#include "DirectoryWalker.h"
+
+#include "Trace.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#if defined(Q_OS_UNIX)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <QDirIterator>
+#include <QFileInfo>
+#endif
+
+namespace
+{
+	// Fichiers par lot : assez pour amortir le vol, assez peu pour que tous les threads en aient
+	const int fileBatchSize = 128;
+	// Réveil de sécurité d'un thread en attente, pour voir une annulation
+	const unsigned long idleWaitMs = 50;
+}
+
+DirectoryWalker::DirectoryWalker(const QStringList& fileSuffixes)
+{
+	for (const QString& fileSuffix : fileSuffixes)
+	{
+		this->fileSuffixes.append(QFile::encodeName(fileSuffix));
+	}
+}
+
+int DirectoryWalker::workerCount()
+{
+	return qMax(1, QThread::idealThreadCount());
+}
+
+bool DirectoryWalker::walk(const QString& folderPath, const FileCallback& onFile, const std::atomic<bool>& canceled)
+{
+	const int workerCount = DirectoryWalker::workerCount();
+	workers.clear();
+	for (int i = 0; i < workerCount; i++)
+	{
+		workers.push_back(std::make_unique<Worker>());
+	}
+	pendingTasks = 0;
+	queuedTasks = 0;
+	Task root;
+	root.folderPath = folderPath;
+	pushTask(0, std::move(root));
+
+	QList<QFuture<void>> helpers;
+	for (int i = 1; i < workerCount; i++)
+	{
+		helpers.append(QtConcurrent::run(
+			[this, i, &onFile, &canceled]()
+			{
+				run(i, onFile, canceled);
+			}
+		));
+	}
+	// L'appelant travaille aussi : le parcours avance même si le pool est déjà occupé
+	run(0, onFile, canceled);
+	for (QFuture<void>& helper : helpers)
+	{
+		helper.waitForFinished();
+	}
+	workers.clear();
+	return !canceled;
+}
+
+QStringList DirectoryWalker::list(const QString& folderPath, const std::atomic<bool>& canceled)
+{
+	std::vector<QStringList> shards(workerCount());
+	const bool completed = walk(folderPath,
+		[&shards](int workerIndex, const QString& filePath)
+		{
+			shards[workerIndex].append(filePath);
+		},
+		canceled
+	);
+	if (!completed)
+	{
+		return QStringList();
+	}
+	QStringList files;
+	for (QStringList& shard : shards)
+	{
+		files.append(std::move(shard));
+	}
+	files.sort();
+	return files;
+}
+
+bool DirectoryWalker::takeTask(int workerIndex, Task& task)
+{
+	{
+		Worker& worker = *workers[workerIndex];
+		QMutexLocker locker(&worker.mutex);
+		if (!worker.tasks.isEmpty())
+		{
+			task = worker.tasks.takeLast();
+			queuedTasks--;
+			return true;
+		}
+	}
+
+	// Vol de la tâche la plus ancienne d'un autre thread : dossier le plus haut dans l'arborescence,
+	// ou premier lot de fichiers
+	const int workerCount = int(workers.size());
+	for (int i = 1; i < workerCount; i++)
+	{
+		Worker& victim = *workers[(workerIndex + i) % workerCount];
+		QMutexLocker locker(&victim.mutex);
+		if (!victim.tasks.isEmpty())
+		{
+			task = victim.tasks.takeFirst();
+			queuedTasks--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void DirectoryWalker::pushTask(int workerIndex, Task&& task)
+{
+	pendingTasks++;
+	{
+		Worker& worker = *workers[workerIndex];
+		QMutexLocker locker(&worker.mutex);
+		worker.tasks.append(std::move(task));
+	}
+	queuedTasks++;
+	// Sous idleMutex : un thread qui va attendre a soit déjà vu queuedTasks, soit est dans wait()
+	QMutexLocker locker(&idleMutex);
+	taskAvailable.wakeOne();
+}
+
+void DirectoryWalker::run(int workerIndex, const FileCallback& onFile, const std::atomic<bool>& canceled)
+{
+	// Un intervalle par thread : les fins décalées montrent ce qui a manqué de travail à voler
+	Trace::Span span("walkFolders", Trace::Stage);
+	Task task;
+	while (!canceled)
+	{
+		if (takeTask(workerIndex, task))
+		{
+			if (!task.folderPath.isEmpty())
+			{
+				scanFolder(workerIndex, task.folderPath);
+			}
+			for (const QString& filePath : std::as_const(task.filePaths))
+			{
+				if (canceled)
+				{
+					break;
+				}
+				onFile(workerIndex, filePath);
+			}
+			if (--pendingTasks == 0)
+			{
+				QMutexLocker locker(&idleMutex);
+				taskAvailable.wakeAll();
+			}
+			continue;
+		}
+
+		QMutexLocker locker(&idleMutex);
+		if (pendingTasks == 0)
+		{
+			return;
+		}
+		if (queuedTasks == 0)
+		{
+			taskAvailable.wait(&idleMutex, idleWaitMs);
+		}
+	}
+}
+
+void DirectoryWalker::scanFolder(int workerIndex, const QString& folderPath)
+{
+	Task files;
+	const auto addFile = [this, workerIndex, &files](const QString& filePath)
+	{
+		files.filePaths.append(filePath);
+		if (files.filePaths.size() >= fileBatchSize)
+		{
+			pushTask(workerIndex, std::move(files));
+			files = Task();
+		}
+	};
+
+#if defined(Q_OS_UNIX)
+	DIR* dir = ::opendir(QFile::encodeName(folderPath).constData());
+	if (!dir)
+	{
+		return;
+	}
+	const int dirFd = ::dirfd(dir);
+	while (const dirent* entry = ::readdir(dir))
+	{
+		const QByteArrayView fileName(entry->d_name);
+		// Comme QDirIterator sans QDir::Hidden : ni ".", ni "..", ni fichiers cachés
+		if (fileName.startsWith('.'))
+		{
+			continue;
+		}
+
+		bool isFolder = entry->d_type == DT_DIR;
+		bool isFile = entry->d_type == DT_REG;
+		if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+		{
+			// Seul cas où il faut un stat : lien symbolique ou système de fichiers sans d_type.
+			// Les liens vers un dossier ne sont pas suivis, ceux vers un fichier sont gardés
+			struct stat entryStat;
+			bool isLink = entry->d_type == DT_LNK;
+			if (!isLink)
+			{
+				if (::fstatat(dirFd, entry->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) != 0)
+				{
+					continue;
+				}
+				isLink = S_ISLNK(entryStat.st_mode);
+				isFolder = S_ISDIR(entryStat.st_mode);
+				isFile = S_ISREG(entryStat.st_mode);
+			}
+			if (isLink)
+			{
+				isFolder = false;
+				isFile = ::fstatat(dirFd, entry->d_name, &entryStat, 0) == 0 && S_ISREG(entryStat.st_mode);
+			}
+		}
+
+		if (isFolder)
+		{
+			Task folder;
+			folder.folderPath = folderPath + '/' + QFile::decodeName(fileName.toByteArray());
+			pushTask(workerIndex, std::move(folder));
+		}
+		else if (isFile && matches(fileName))
+		{
+			addFile(folderPath + '/' + QFile::decodeName(fileName.toByteArray()));
+		}
+	}
+	::closedir(dir);
+#else
+	// Ailleurs, le type vient de l'énumération elle-même (FindFirstFile sous Windows)
+	QDirIterator it(folderPath, QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot);
+	while (it.hasNext())
+	{
+		const QString filePath = it.next();
+		const QFileInfo fileInfo = it.fileInfo();
+		if (fileInfo.isDir())
+		{
+			if (!fileInfo.isSymLink())
+			{
+				Task folder;
+				folder.folderPath = filePath;
+				pushTask(workerIndex, std::move(folder));
+			}
+		}
+		else if (matches(QFile::encodeName(fileInfo.fileName())))
+		{
+			addFile(filePath);
+		}
+	}
+#endif
+
+	// Le reste est traité par ce thread, qui le reprend en premier (dernier empilé)
+	if (!files.filePaths.isEmpty())
+	{
+		pushTask(workerIndex, std::move(files));
+	}
+}
+
+bool DirectoryWalker::matches(QByteArrayView fileName) const
+{
+	for (const QByteArray& fileSuffix : fileSuffixes)
+	{
+		if (fileName.size() >= fileSuffix.size()
+			&& qstrnicmp(fileName.data() + fileName.size() - fileSuffix.size(), fileSuffix.constData(), uint(fileSuffix.size())) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,66 @@
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <QByteArrayList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Parcours récursif d'un dossier sur plusieurs threads : chaque thread dépile ses propres
+// tâches et vole celles des autres quand il n'a plus rien, ou attend qu'il en arrive.
+// Une tâche est un sous-dossier à lire ou un lot de fichiers trouvés : un dossier unique
+// de 100 000 txtp est donc lu par un thread mais traité par tous. Les suffixes sont testés
+// pendant l'énumération (type d'entrée fourni par readdir, sans stat), et chaque fichier
+// retenu est passé à onFile depuis le thread qui a pris son lot, avec le numéro de ce thread
+// (0 à workerCount() - 1) : l'appelant peut ranger ses résultats par thread, sans verrou.
+class DirectoryWalker
+{
+public:
+	using FileCallback = std::function<void(int workerIndex, const QString& filePath)>;
+
+	// Suffixes du type ".txtp", comparés sans tenir compte de la casse comme QDirIterator
+	explicit DirectoryWalker(const QStringList& fileSuffixes);
+
+	static int workerCount();
+	// Renvoie false si le parcours a été annulé par canceled
+	bool walk(const QString& folderPath, const FileCallback& onFile, const std::atomic<bool>& canceled);
+	// Liste triée des fichiers, pour les appelants qui n'ont pas besoin du flux
+	QStringList list(const QString& folderPath, const std::atomic<bool>& canceled);
+
+private:
+	// Dossier à lire si folderPath n'est pas vide, sinon lot de fichiers à passer à onFile
+	struct Task
+	{
+		QString folderPath;
+		QStringList filePaths;
+	};
+
+	struct Worker
+	{
+		QMutex mutex;
+		QList<Task> tasks;
+	};
+
+	bool takeTask(int workerIndex, Task& task);
+	void pushTask(int workerIndex, Task&& task);
+	void scanFolder(int workerIndex, const QString& folderPath);
+	void run(int workerIndex, const FileCallback& onFile, const std::atomic<bool>& canceled);
+	bool matches(QByteArrayView fileName) const;
+
+	QByteArrayList fileSuffixes;
+	std::vector<std::unique_ptr<Worker>> workers;
+	// Tâches empilées mais pas encore terminées : 0 = parcours terminé
+	std::atomic<qsizetype> pendingTasks { 0 };
+	// Tâches empilées et pas encore prises : un thread sans travail n'attend que si c'est 0
+	std::atomic<qsizetype> queuedTasks { 0 };
+	QMutex idleMutex;
+	QWaitCondition taskAvailable;
+};
+
+#endif // DIRECTORYWALKER_H
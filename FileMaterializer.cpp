@@ -0,0 +1,246 @@
+#include "FileMaterializer.h"
+
+#include <QFile>
+
+#if defined(Q_OS_LINUX)
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(Q_OS_UNIX)
+#include <cerrno>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+namespace
+{
+#if defined(Q_OS_LINUX)
+	bool isUnsupportedError(int error)
+	{
+		return error == EOPNOTSUPP || error == ENOTTY || error == EXDEV || error == EINVAL || error == ENOSYS;
+	}
+
+	// Clone FICLONE ou copy_file_range : les données ne repassent pas par l'espace utilisateur
+	int kernelCopy(const QString& sourcePath, const QString& destinationPath, bool clone)
+	{
+		const int in = ::open(QFile::encodeName(sourcePath).constData(), O_RDONLY | O_CLOEXEC);
+		if (in < 0)
+		{
+			return errno;
+		}
+		struct stat sourceStat;
+		if (::fstat(in, &sourceStat) != 0)
+		{
+			const int error = errno;
+			::close(in);
+			return error;
+		}
+		const QByteArray destination = QFile::encodeName(destinationPath);
+		const int out = ::open(destination.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, (sourceStat.st_mode & 0777) | 0600);
+		if (out < 0)
+		{
+			const int error = errno;
+			::close(in);
+			return error;
+		}
+
+		int error = 0;
+		if (clone)
+		{
+			if (::ioctl(out, FICLONE, in) != 0)
+			{
+				error = errno;
+			}
+		}
+		else
+		{
+			off_t remaining = sourceStat.st_size;
+			while (remaining > 0)
+			{
+				const ssize_t copied = ::copy_file_range(in, nullptr, out, nullptr, size_t(remaining), 0);
+				if (copied < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (copied <= 0)
+				{
+					error = copied < 0 ? errno : EIO;
+					break;
+				}
+				remaining -= copied;
+			}
+		}
+
+		::close(in);
+		if (::close(out) != 0 && error == 0)
+		{
+			error = errno;
+		}
+		if (error != 0)
+		{
+			::unlink(destination.constData());
+		}
+		return error;
+	}
+#endif
+}
+
+void FileMaterializer::setStrategy(Strategy strategy)
+{
+	this->strategy = strategy;
+	for (std::atomic<bool>& strategyUnsupported : unsupported)
+	{
+		strategyUnsupported = false;
+	}
+}
+
+FileMaterializer::Strategy FileMaterializer::materialize(const QString& sourcePath, const QString& destinationPath)
+{
+	// Le lien physique partage l'inode avec la source : jamais choisi automatiquement,
+	// un outil qui modifierait la sortie sur place abîmerait la VF d'origine
+	static const Strategy autoOrder[] = { Reflink, KernelCopy, Copy };
+
+	if (strategy != Auto)
+	{
+		const Outcome outcome = tryStrategy(strategy, sourcePath, destinationPath);
+		if (outcome == Done)
+		{
+			counts[strategy]++;
+			return strategy;
+		}
+		if (outcome == Failed || strategy == Copy)
+		{
+			return StrategyCount;
+		}
+		// Méthode imposée mais impossible ici : on se rabat sur la copie
+		if (tryStrategy(Copy, sourcePath, destinationPath) == Done)
+		{
+			counts[Copy]++;
+			return Copy;
+		}
+		return StrategyCount;
+	}
+
+	for (const Strategy candidate : autoOrder)
+	{
+		if (unsupported[candidate])
+		{
+			continue;
+		}
+		const Outcome outcome = tryStrategy(candidate, sourcePath, destinationPath);
+		if (outcome == Done)
+		{
+			counts[candidate]++;
+			return candidate;
+		}
+		if (outcome == Failed)
+		{
+			return StrategyCount;
+		}
+		unsupported[candidate] = true;
+	}
+	return StrategyCount;
+}
+
+FileMaterializer::Strategy FileMaterializer::materializeDuplicate(const QString& outputPath, const QString& destinationPath)
+{
+	// Ici le lien ne touche pas à la VF d'origine, seulement à une autre sortie identique
+	if ((strategy == Auto || strategy == Hardlink) && !unsupported[Hardlink])
+	{
+		const Outcome outcome = tryStrategy(Hardlink, outputPath, destinationPath);
+		if (outcome == Done)
+		{
+			counts[Hardlink]++;
+			return Hardlink;
+		}
+		if (outcome == Unsupported && strategy == Auto)
+		{
+			unsupported[Hardlink] = true;
+		}
+	}
+	return materialize(outputPath, destinationPath);
+}
+
+FileMaterializer::Outcome FileMaterializer::tryStrategy(Strategy strategy, const QString& sourcePath, const QString& destinationPath)
+{
+	switch (strategy)
+	{
+	case Hardlink:
+	{
+#if defined(Q_OS_UNIX)
+		if (::link(QFile::encodeName(sourcePath).constData(), QFile::encodeName(destinationPath).constData()) == 0)
+		{
+			return Done;
+		}
+		return (errno == EXDEV || errno == EPERM || errno == EMLINK) ? Unsupported : Failed;
+#elif defined(Q_OS_WIN)
+		if (CreateHardLinkW(reinterpret_cast<LPCWSTR>(destinationPath.utf16()), reinterpret_cast<LPCWSTR>(sourcePath.utf16()), nullptr))
+		{
+			return Done;
+		}
+		const DWORD error = GetLastError();
+		return (error == ERROR_NOT_SAME_DEVICE || error == ERROR_INVALID_FUNCTION || error == ERROR_TOO_MANY_LINKS) ? Unsupported : Failed;
+#else
+		return Unsupported;
+#endif
+	}
+	case Reflink:
+	case KernelCopy:
+	{
+#if defined(Q_OS_LINUX)
+		const int error = kernelCopy(sourcePath, destinationPath, strategy == Reflink);
+		if (error == 0)
+		{
+			return Done;
+		}
+		return isUnsupportedError(error) ? Unsupported : Failed;
+#else
+		return Unsupported;
+#endif
+	}
+	case Copy:
+		return QFile::copy(sourcePath, destinationPath) ? Done : Failed;
+	case Auto:
+	case StrategyCount:
+		break;
+	}
+	return Unsupported;
+}
+
+void FileMaterializer::resetCounts()
+{
+	for (std::atomic<int>& count : counts)
+	{
+		count = 0;
+	}
+}
+
+QString FileMaterializer::strategyName(Strategy strategy)
+{
+	switch (strategy)
+	{
+	case Auto: return "auto";
+	case Hardlink: return "hardlink";
+	case Reflink: return "reflink";
+	case KernelCopy: return "kernel";
+	case Copy: return "copy";
+	case StrategyCount: break;
+	}
+	return QString();
+}
+
+FileMaterializer::Strategy FileMaterializer::strategyFromName(const QString& name)
+{
+	for (int i = 0; i < StrategyCount; i++)
+	{
+		if (strategyName(Strategy(i)) == name)
+		{
+			return Strategy(i);
+		}
+	}
+	return StrategyCount;
+}
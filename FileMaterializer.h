@@ -0,0 +1,55 @@
+#ifndef FILEMATERIALIZER_H
+#define FILEMATERIALIZER_H
+
+#include <QString>
+
+#include <atomic>
+
+// Écrit un fichier de sortie à partir d'une voix source, par la méthode la moins chère
+// disponible : clone reflink (btrfs/xfs), copie côté noyau (copy_file_range), lien physique,
+// ou copie classique en dernier recours.
+// En automatique, une méthode refusée par le système de fichiers n'est plus retentée.
+class FileMaterializer
+{
+public:
+	enum Strategy
+	{
+		Auto,
+		Hardlink,
+		Reflink,
+		KernelCopy,
+		Copy,
+		StrategyCount
+	};
+
+	void setStrategy(Strategy strategy);
+	Strategy getStrategy() const { return strategy; }
+
+	// La destination ne doit pas exister ; renvoie StrategyCount en cas d'échec
+	Strategy materialize(const QString& sourcePath, const QString& destinationPath);
+	// Pour une sortie identique à une autre déjà écrite : lien physique entre les deux sorties
+	// si la méthode le permet, sinon comme materialize()
+	Strategy materializeDuplicate(const QString& outputPath, const QString& destinationPath);
+
+	void resetCounts();
+	int getCount(Strategy strategy) const { return counts[strategy]; }
+
+	static QString strategyName(Strategy strategy);
+	static Strategy strategyFromName(const QString& name);
+
+private:
+	enum Outcome
+	{
+		Done,
+		Unsupported,
+		Failed
+	};
+
+	Outcome tryStrategy(Strategy strategy, const QString& sourcePath, const QString& destinationPath);
+
+	Strategy strategy = Auto;
+	std::atomic<bool> unsupported[StrategyCount] = {};
+	std::atomic<int> counts[StrategyCount] = {};
+};
+
+#endif // FILEMATERIALIZER_H
@@ -0,0 +1,1606 @@
+#include "Frenchiser.h"
+
+#include "DirectoryWalker.h"
+#include "Trace.h"
+#include "TxtpParser.h"
+#include "WwiseBankReader.h"
+#include "WwisePackageWriter.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
+#if defined(Q_OS_UNIX)
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	const QString planHeader = "# OblivionFrenchiser plan 1";
+	const QString planVoiceFolder = "# voiceFolder\t";
+	const QString packageFileName = "OblivionFrenchiser.pck";
+
+	// Numéro d'inode, proche de l'ordre des données sur la plupart des systèmes de fichiers ;
+	// 0 ailleurs, l'ordre des chemins prend alors le relais
+	quint64 fileLocation(const QString& filePath)
+	{
+#if defined(Q_OS_UNIX)
+		struct stat fileStat;
+		if (::stat(QFile::encodeName(filePath).constData(), &fileStat) == 0)
+		{
+			return quint64(fileStat.st_ino);
+		}
+#else
+		Q_UNUSED(filePath);
+#endif
+		return 0;
+	}
+
+	// Un lot par thread du parcours : chaque lot est trié sur le pool, puis les lots sont
+	// fusionnés deux à deux, toujours en parallèle. Les éléments sont déplacés, jamais copiés.
+	template <typename T, typename LessThan>
+	QList<T> sortShards(std::vector<QList<T>>& shards, LessThan lessThan)
+	{
+		QtConcurrent::blockingMap(shards,
+			[&lessThan](QList<T>& shard)
+			{
+				std::sort(shard.begin(), shard.end(), lessThan);
+			}
+		);
+		while (shards.size() > 1)
+		{
+			std::vector<QList<T>> merged((shards.size() + 1) / 2);
+			QList<qsizetype> pairs;
+			for (qsizetype i = 0; i < qsizetype(merged.size()); i++)
+			{
+				pairs.append(i);
+			}
+			QtConcurrent::blockingMap(pairs,
+				[&shards, &merged, &lessThan](qsizetype& i)
+				{
+					QList<T>& left = shards[2 * i];
+					if (2 * i + 1 == qsizetype(shards.size()))
+					{
+						merged[i] = std::move(left);
+						return;
+					}
+					QList<T>& right = shards[2 * i + 1];
+					merged[i].reserve(left.size() + right.size());
+					std::merge(std::make_move_iterator(left.begin()), std::make_move_iterator(left.end()),
+						std::make_move_iterator(right.begin()), std::make_move_iterator(right.end()),
+						std::back_inserter(merged[i]), lessThan);
+				}
+			);
+			shards = std::move(merged);
+		}
+		return shards.empty() ? QList<T>() : std::move(shards.front());
+	}
+}
+
+Frenchiser::Frenchiser()
+	: correspondingRaces{
+		{ "high_elf", { "haut_elfe", "imperial", "shéogorath" } },
+		{ "wood_elf", { "haut_elfe", "imperial", "shéogorath" } },
+		{ "redguard", { "rougegarde", "imperial", "haut elfe", "nordique", "shéogorath" } }, //je sais pas encore nordique ou haut elfe
+		{ "dark_elf", { "haut_elfe", "imperial", "shéogorath" } },
+		{ "argonian", { "argonien", "haut_elfe", "shéogorath" } },
+		{ "khajiit", { "argonien", "haut_elfe", "shéogorath" } },
+		{ "nord", { "nordique", "rougegarde", "imperial", "haut elfe", "shéogorath" } }, //je sais pas encore rougegarde ou impérial
+		{ "orc", { "nordique", "rougegarde", "imperial", "shéogorath" } }, //je sais pas encore rougegarde ou impérial
+		{ "breton", { "imperial", "haut_elfe", "nordique", "shéogorath" } },
+		{ "imperial", { "imperial", "haut_elfe", "rougegarde", "nordique", "shéogorath" } },
+		{ "dark_seducer", { "vil_séducteur", "shéogorath" } },
+		{ "golden_saint", { "saint_doré", "shéogorath" } },
+		{ "sheogorath", { "shéogorath", "shéogorath" } },
+		{ "dremora", { "drémora", "shéogorath" } }
+	}
+	, subFolders{ "altvoice", "beggar" }
+	, shittyReplace{
+		{"_alt01", ""},
+		{"_elf_f_0300", "_1"},
+	}
+{
+	voiceMatcher.compile(shittyReplace, subFolders, correspondingRaces);
+}
+
+void Frenchiser::setOptions(const Options& options)
+{
+	this->options = options;
+	materializer.setStrategy(options.outputStrategy);
+}
+
+void Frenchiser::cancel()
+{
+	canceled = true;
+}
+
+void Frenchiser::resetCancel()
+{
+	canceled = false;
+}
+
+bool Frenchiser::isCanceled() const
+{
+	return canceled;
+}
+
+QString Frenchiser::defaultCacheFolder(const QSettings& settings)
+{
+	// À côté du fichier de QSettings, sauf s'il est dans la base de registre
+	const QFileInfo settingsFile(settings.fileName());
+	if (settingsFile.isAbsolute() && settingsFile.dir().exists())
+	{
+		return settingsFile.absolutePath();
+	}
+	const QString folder = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+	QDir().mkpath(folder);
+	return folder;
+}
+
+void Frenchiser::loadCaches(const QString& cacheFolder)
+{
+	txtpCache.load(cacheFolder + "/txtpCache.bin");
+	voiceCache.load(cacheFolder + "/voiceCache.bin");
+}
+
+void Frenchiser::saveTxtpCache()
+{
+	if (!isCanceled())
+	{
+		txtpCache.save();
+	}
+}
+
+void Frenchiser::saveVoiceCache()
+{
+	if (!isCanceled())
+	{
+		voiceCache.save();
+	}
+}
+
+QStringList Frenchiser::getFilesInFolder(const QString& folderPath, const QStringList& fileSuffixes) const
+{
+	Trace::Span span("getFilesInFolder", Trace::Stage, folderPath);
+	DirectoryWalker walker(fileSuffixes);
+	return walker.list(folderPath, canceled);
+}
+
+QString Frenchiser::getLineId(const QString& filePath) const
+{
+	QString part = QFileInfo(filePath).baseName();
+	QStringList parts = part.split("_");
+	for (int i = parts.size() - 1; i >= 0; i--)
+	{
+		if (parts[i].size() == 8)
+		{
+			return parts[i];
+		}
+	}
+	return QString();
+}
+
+QString Frenchiser::getFullLineId(const QString& filePath) const
+{
+	QString part = QFileInfo(filePath).fileName();
+	QStringList parts = part.split("_");
+	bool processId = false;
+	QString fullLineId;
+	for (const QString& part : parts)
+	{
+		if (processId)
+		{
+			if (part.contains("."))
+			{
+				break;
+			}
+			fullLineId += part + "_";
+		}
+
+		if (part.size() == 1)
+		{
+			processId = true;
+		}
+	}
+
+	fullLineId.removeLast();
+	return fullLineId;
+}
+
+QChar Frenchiser::getSex(const QString& filePath) const
+{
+	const QString fileName = QFileInfo(filePath).baseName();
+	const QStringList parts = fileName.split("_");
+	for (const QString& part : parts)
+	{
+		if (part.size() == 1)
+		{
+			if (part == "m" || part == "f")
+			{
+				return part[0];
+			}
+		}
+	}
+	return QChar();
+}
+
+QList<WemFile> Frenchiser::s1ProcessFolder(const QString& folderPath) const
+{
+	RunReport::Scope scope(runReport, RunReport::S1Scan);
+	txtpByteCount = 0;
+	txtpCache.addScanRoot(folderPath);
+	// Les txtp sont analysés par lots, par le thread qui prend le lot, sans attendre la fin du parcours,
+	// et rangés dans le lot de résultats de ce thread
+	std::vector<QList<WemFile>> shards(DirectoryWalker::workerCount());
+	DirectoryWalker walker(QStringList() << ".txtp");
+	const bool completed = walker.walk(folderPath,
+		[this, &shards](int workerIndex, const QString& filePath)
+		{
+			shards[workerIndex].append(s1ProcessFile(filePath));
+		},
+		canceled
+	);
+	if (!completed)
+	{
+		return QList<WemFile>();
+	}
+	// Ordre stable d'un lancement à l'autre, pour les logs
+	return sortShards(shards,
+		[this](const WemFile& left, const WemFile& right)
+		{
+			return pendingWemPaths.lessThan(left.path, right.path);
+		}
+	);
+}
+
+WemFile Frenchiser::s1ProcessFile(const QString& filePath) const
+{
+	Trace::Span span("s1ProcessFile", Trace::File, filePath);
+	WemFile result;
+	result.path = pendingWemPaths.add(filePath);
+	progress.add();
+
+	ScanCache::Entry cached;
+	{
+		Trace::Span statSpan("cacheLookup", Trace::Operation);
+		const QFileInfo fileInfo(filePath);
+		cached.size = fileInfo.size();
+		cached.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+	}
+	txtpByteCount += cached.size;
+	if (txtpCache.find(filePath, cached.size, cached.lastModified, cached))
+	{
+		result.id = cached.id;
+		result.codec = internCodec(cached.text);
+		return result;
+	}
+
+	QFile file(filePath);
+	{
+		Trace::Span openSpan("open", Trace::Operation);
+		if (!file.open(QFile::ReadOnly))
+		{
+			result.error = TxtpParser::errorString(TxtpParser::OpenError);
+			return result;
+		}
+	}
+
+	QByteArray fileContent;
+	{
+		Trace::Span readSpan("read", Trace::Operation);
+		fileContent = file.readAll();
+		file.close();
+	}
+	Trace::Span parseSpan("parse", Trace::Operation);
+	const TxtpParser::Result txtp = TxtpParser::parse(fileContent);
+	if (txtp.error != TxtpParser::NoError)
+	{
+		result.error = TxtpParser::errorString(txtp.error);
+		return result;
+	}
+	result.id = txtp.id;
+	result.codec = internCodec(QString::fromLatin1(txtp.codec));
+
+	cached.id = result.id;
+	cached.text = result.codec;
+	txtpCache.insert(filePath, cached);
+	return result;
+}
+
+QList<WemFile> Frenchiser::s1ProcessBankFolder(const QString& folderPath) const
+{
+	RunReport::Scope scope(runReport, RunReport::S1Banks);
+	QList<WemFile> result;
+	const QStringList bankFilePaths = getFilesInFolder(folderPath, QStringList() << ".bnk" << ".pck");
+	if (bankFilePaths.isEmpty())
+	{
+		return result;
+	}
+
+	// Les banks ne contiennent que les hash des events : les noms viennent
+	// du wwnames.txt posé à côté, comme pour Wwiser
+	QList<QByteArray> eventNames;
+	QFile namesFile(folderPath + "/wwnames.txt");
+	if (namesFile.open(QFile::ReadOnly))
+	{
+		for (const QByteArray& line : namesFile.readAll().split('\n'))
+		{
+			const QByteArray name = line.trimmed();
+			if (!name.isEmpty() && !name.startsWith('#'))
+			{
+				eventNames.append(name);
+			}
+		}
+		namesFile.close();
+	}
+
+	for (const QString& bankFilePath : bankFilePaths)
+	{
+		if (isCanceled())
+		{
+			return QList<WemFile>();
+		}
+
+		WwiseBankReader reader;
+		if (!reader.open(bankFilePath))
+		{
+			WemFile wemFile;
+			wemFile.path = pendingWemPaths.add(bankFilePath);
+			wemFile.error = reader.errorString();
+			result.append(wemFile);
+			continue;
+		}
+
+		for (const QByteArray& eventName : eventNames)
+		{
+			WwiseBankReader::Sound sound;
+			if (reader.findSound(WwiseBankReader::hashName(eventName), sound))
+			{
+				// Chemin virtuel : la suite ne se sert que du nom de l'event
+				WemFile wemFile;
+				wemFile.path = pendingWemPaths.add(QString(bankFilePath + "/" + QString::fromUtf8(eventName) + ".txtp"));
+				wemFile.id = sound.wemId;
+				wemFile.codec = internCodec(WwiseBankReader::codecName(sound.pluginId));
+				result.append(wemFile);
+			}
+		}
+
+		if (eventNames.isEmpty() && reader.eventCount() > 0)
+		{
+			WemFile wemFile;
+			wemFile.path = pendingWemPaths.add(bankFilePath);
+			wemFile.error = QObject::tr("Aucun nom d'event (wwnames.txt manquant)");
+			result.append(wemFile);
+		}
+	}
+	return result;
+}
+
+void Frenchiser::setWemFiles(QList<WemFile> wemFiles)
+{
+	RunReport::Scope scope(runReport, RunReport::S1Index);
+	matchingFiles.clear();
+	watchWemFilesByLineId.clear();
+	// Les chemins des nouveaux enregistrements sont dans pendingWemPaths
+	wemPaths.clear();
+	wemPaths.swap(pendingWemPaths);
+
+	// Séparation sur place, en gardant l'ordre : les fichiers valides restent dans la liste reçue
+	const auto invalidBegin = std::stable_partition(wemFiles.begin(), wemFiles.end(),
+		[](const WemFile& wemFile)
+		{
+			return wemFile.error.isEmpty();
+		}
+	);
+	const qsizetype validCount = invalidBegin - wemFiles.begin();
+	invalidWemFiles.clear();
+	invalidWemFiles.reserve(wemFiles.size() - validCount);
+	std::move(invalidBegin, wemFiles.end(), std::back_inserter(invalidWemFiles));
+	wemFiles.resize(validCount);
+	this->wemFiles = std::move(wemFiles);
+}
+
+QList<VoiceFile> Frenchiser::s2ProcessVoiceFolder(const QString& folderPath) const
+{
+	RunReport::Scope scope(runReport, RunReport::S2Scan);
+	voiceByteCount = 0;
+	voiceCache.addScanRoot(folderPath);
+	std::vector<QList<VoiceFile>> shards(DirectoryWalker::workerCount());
+	DirectoryWalker walker(QStringList() << ".mp3" << ".wem");
+	const bool completed = walker.walk(folderPath,
+		[this, &shards](int workerIndex, const QString& filePath)
+		{
+			shards[workerIndex].append(s2ProcessVoiceFile(filePath));
+		},
+		canceled
+	);
+	if (!completed)
+	{
+		return QList<VoiceFile>();
+	}
+	return sortShards(shards,
+		[this](const VoiceFile& left, const VoiceFile& right)
+		{
+			return pendingVoicePaths.lessThan(left.path, right.path);
+		}
+	);
+}
+
+VoiceFile Frenchiser::s2ProcessVoiceFile(const QString& filePath) const
+{
+	// Le nom d'event attendu se déduit du chemin à la demande (VoiceMatcher::voiceName)
+	Trace::Span span("s2ProcessVoiceFile", Trace::File, filePath);
+	VoiceFile result;
+	result.path = pendingVoicePaths.add(filePath);
+	progress.add();
+	probeVoiceFile(filePath, result);
+	return result;
+}
+
+void Frenchiser::probeVoiceFile(const QString& filePath, VoiceFile& voiceFile) const
+{
+	ScanCache::Entry cached;
+	{
+		Trace::Span statSpan("cacheLookup", Trace::Operation);
+		const QFileInfo fileInfo(filePath);
+		cached.size = fileInfo.size();
+		cached.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+	}
+	voiceByteCount += cached.size;
+	voiceFile.size = cached.size;
+	voiceFile.lastModified = cached.lastModified;
+	AudioProbe::Info info;
+	if (voiceCache.find(filePath, cached.size, cached.lastModified, cached))
+	{
+		info = AudioProbe::fromText(cached.text);
+	}
+	else
+	{
+		// Quelques centaines d'octets lus par fichier, pas le fichier entier
+		Trace::Span probeSpan("probe", Trace::Operation);
+		info = AudioProbe::probeFile(filePath);
+		cached.text = AudioProbe::toText(info);
+		voiceCache.insert(filePath, cached);
+	}
+	voiceFile.codec = info.codec;
+	voiceFile.channels = info.channels;
+	voiceFile.sampleRate = info.sampleRate;
+	voiceFile.durationMs = info.durationMs;
+}
+
+void Frenchiser::setVoiceFiles(QList<VoiceFile> voiceFiles)
+{
+	RunReport::Scope scope(runReport, RunReport::S2Index);
+	matchingFiles.clear();
+	voiceLineIdsBySex.clear();
+	watchVoiceFilesByFolder.clear();
+	this->voiceFiles = std::move(voiceFiles);
+	voicePaths.clear();
+	voicePaths.swap(pendingVoicePaths);
+
+	// Calculé une fois ici plutôt que pour chaque voix manquante du rapport ; les clés se
+	// calculent sur le pool, puis le QSet se remplit pendant que le matcher s'indexe
+	const QList<QString> lineIdKeys = QtConcurrent::blockingMapped<QList<QString>>(this->voiceFiles,
+		[this](const VoiceFile& voiceFile)
+		{
+			const QString filePath = voicePaths.filePath(voiceFile.path);
+			const QString lineId = getFullLineId(filePath);
+			return lineId.isEmpty() ? QString() : getSex(VoiceMatcher::voiceName(filePath)) + lineId;
+		}
+	);
+	QFuture<void> lineIdsFuture = QtConcurrent::run(
+		[this, &lineIdKeys]()
+		{
+			voiceLineIdsBySex.reserve(lineIdKeys.size());
+			for (const QString& key : lineIdKeys)
+			{
+				if (!key.isEmpty())
+				{
+					voiceLineIdsBySex.insert(key);
+				}
+			}
+		}
+	);
+	voiceMatcher.index(this->voiceFiles, voicePaths);
+	lineIdsFuture.waitForFinished();
+}
+
+QString Frenchiser::internCodec(const QString& codec) const
+{
+	// Une poignée de codecs pour des centaines de milliers de txtp : une seule copie de chaque
+	QMutexLocker locker(&codecsMutex);
+	for (const QString& knownCodec : codecs)
+	{
+		if (knownCodec == codec)
+		{
+			return knownCodec;
+		}
+	}
+	codecs.append(codec);
+	return codec;
+}
+
+MatchingFile Frenchiser::s3ProcessVoice(const WemFile& wemFile) const
+{
+	Trace::Span span("s3ProcessVoice", Trace::File);
+	MatchingFile result;
+	result.wemFile = &wemFile;
+	progress.add();
+	const QStringView baseName = VoiceMatcher::baseName(wemPaths.fileName(wemFile.path));
+	VoiceMatcher::Match match;
+	{
+		Trace::Span lookupSpan("lookup", Trace::Operation);
+		match = voiceMatcher.find(baseName);
+	}
+	result.voiceFile = match.voiceFile < 0 ? nullptr : &voiceFiles[match.voiceFile];
+	result.found = result.voiceFile != nullptr;
+	result.rules = match.rules;
+	result.race = match.race;
+	result.raceTarget = match.raceTarget;
+
+	//Sauvage !!
+	if (!result.found && options.fuzzyMatching)
+	{
+		Trace::Span fuzzySpan("fuzzyLookup", Trace::Operation);
+		const VoiceMatcher::FuzzyMatch fuzzyMatch = voiceMatcher.findFuzzy(baseName);
+		result.voiceFile = fuzzyMatch.voiceFile < 0 ? nullptr : &voiceFiles[fuzzyMatch.voiceFile];
+		result.found = result.voiceFile != nullptr;
+		result.confidence = fuzzyMatch.confidence;
+		result.rules = result.found ? VoiceMatcher::FuzzyRule : 0;
+	}
+
+	// La durée attendue n'est ni dans les txtp ni dans les banks : seul le codec est vérifié
+	result.codecMismatch = result.found && !AudioProbe::isCompatible(wemFile.codec, result.voiceFile->codec);
+	return result;
+}
+
+void Frenchiser::setMatchingFiles(const QList<MatchingFile>& matchingFiles)
+{
+	outputGroups.clear();
+	this->matchingFiles = matchingFiles;
+	codecMismatchCount = int(std::count_if(matchingFiles.constBegin(), matchingFiles.constEnd(),
+		[](const MatchingFile& matchingFile)
+		{
+			return matchingFile.codecMismatch;
+		}
+	));
+}
+
+void Frenchiser::planOutputs()
+{
+	RunReport::Scope scope(runReport, RunReport::S3Plan);
+	outputGroups.clear();
+
+	// Avec les races de repli, beaucoup de wem pointent sur la même voix
+	QHash<const VoiceFile*, qsizetype> groupByVoiceFile;
+	for (const MatchingFile& matchingFile : matchingFiles)
+	{
+		if (!matchingFile.found || (matchingFile.codecMismatch && options.skipCodecMismatches))
+		{
+			continue;
+		}
+		auto it = groupByVoiceFile.constFind(matchingFile.voiceFile);
+		if (it == groupByVoiceFile.constEnd())
+		{
+			it = groupByVoiceFile.insert(matchingFile.voiceFile, outputGroups.size());
+			OutputGroup outputGroup;
+			outputGroup.sourcePath = voicePaths.filePath(matchingFile.voiceFile->path);
+			outputGroups.append(outputGroup);
+		}
+		outputGroups[*it].matchingFiles.append(&matchingFile);
+	}
+
+	// Voix différentes mais contenu identique : on ne hache que les tailles en collision
+	QtConcurrent::blockingMap(outputGroups,
+		[](OutputGroup& outputGroup)
+		{
+			outputGroup.size = QFileInfo(outputGroup.sourcePath).size();
+			outputGroup.sourceLocation = fileLocation(outputGroup.sourcePath);
+		}
+	);
+	QHash<qint64, int> groupCountBySize;
+	for (const OutputGroup& outputGroup : outputGroups)
+	{
+		groupCountBySize[outputGroup.size]++;
+	}
+	QtConcurrent::blockingMap(outputGroups,
+		[&groupCountBySize](OutputGroup& outputGroup)
+		{
+			if (groupCountBySize.value(outputGroup.size) < 2)
+			{
+				return;
+			}
+			QFile file(outputGroup.sourcePath);
+			QCryptographicHash hash(QCryptographicHash::Sha1);
+			if (file.open(QFile::ReadOnly) && hash.addData(&file))
+			{
+				outputGroup.contentHash = hash.result();
+			}
+		}
+	);
+
+	QHash<QByteArray, qsizetype> groupByContentHash;
+	QList<OutputGroup> uniqueGroups;
+	for (OutputGroup& outputGroup : outputGroups)
+	{
+		if (!outputGroup.contentHash.isEmpty())
+		{
+			const auto it = groupByContentHash.constFind(outputGroup.contentHash);
+			if (it != groupByContentHash.constEnd())
+			{
+				uniqueGroups[*it].matchingFiles += outputGroup.matchingFiles;
+				continue;
+			}
+			groupByContentHash.insert(outputGroup.contentHash, uniqueGroups.size());
+		}
+		uniqueGroups.append(outputGroup);
+	}
+	outputGroups = uniqueGroups;
+	sortOutputGroups();
+}
+
+void Frenchiser::sortOutputGroups()
+{
+	std::sort(outputGroups.begin(), outputGroups.end(),
+		[](const OutputGroup& left, const OutputGroup& right)
+		{
+			return std::tie(left.sourceLocation, left.sourcePath) < std::tie(right.sourceLocation, right.sourcePath);
+		}
+	);
+}
+
+bool Frenchiser::writePlan(const QString& planPath, const QString& voiceFolder) const
+{
+	// Trié par id pour que deux plans se comparent ligne à ligne
+	struct PlanLine
+	{
+		unsigned int id = 0;
+		qint64 size = 0;
+		quint8 rules = 0;
+		const QString* sourcePath = nullptr;
+	};
+	QList<PlanLine> planLines;
+	for (const OutputGroup& outputGroup : outputGroups)
+	{
+		for (const MatchingFile* matchingFile : outputGroup.matchingFiles)
+		{
+			planLines.append({ matchingFile->wemFile->id, outputGroup.size, matchingFile->rules, &outputGroup.sourcePath });
+		}
+	}
+	std::sort(planLines.begin(), planLines.end(),
+		[](const PlanLine& left, const PlanLine& right)
+		{
+			return left.id < right.id;
+		}
+	);
+
+	QSaveFile file(planPath);
+	if (!file.open(QFile::WriteOnly | QFile::Text))
+	{
+		return false;
+	}
+	QTextStream out(&file);
+	out << planHeader << '\n';
+	out << planVoiceFolder << voiceFolder << '\n';
+	// Sources relatives au dossier des VF : le plan peut être appliqué sur une autre machine
+	const QString voicePrefix = voiceFolder + "/";
+	for (const PlanLine& planLine : planLines)
+	{
+		const QStringView sourcePath = planLine.sourcePath->startsWith(voicePrefix)
+			? QStringView(*planLine.sourcePath).mid(voicePrefix.size())
+			: QStringView(*planLine.sourcePath);
+		out << planLine.id << '\t' << planLine.size << '\t' << VoiceMatcher::ruleNames(planLine.rules) << '\t' << sourcePath << '\n';
+	}
+	out.flush();
+	return file.commit();
+}
+
+bool Frenchiser::loadPlan(const QString& planPath, const QString& voiceFolder)
+{
+	RunReport::Scope scope(runReport, RunReport::S3Plan);
+	QFile file(planPath);
+	if (!file.open(QFile::ReadOnly | QFile::Text))
+	{
+		return false;
+	}
+	QTextStream in(&file);
+	if (in.readLine() != planHeader)
+	{
+		return false;
+	}
+
+	struct PlanLine
+	{
+		unsigned int id = 0;
+		qint64 size = 0;
+		quint8 rules = 0;
+		qsizetype voiceFile = 0;
+	};
+	QList<PlanLine> planLines;
+	QStringList sourcePaths;
+	QHash<QString, qsizetype> voiceFileBySourcePath;
+	QString planVoiceFolderPath;
+	while (!in.atEnd())
+	{
+		const QString line = in.readLine();
+		if (line.startsWith(planVoiceFolder))
+		{
+			planVoiceFolderPath = line.mid(planVoiceFolder.size());
+			continue;
+		}
+		if (line.isEmpty() || line.startsWith('#'))
+		{
+			continue;
+		}
+
+		const QList<QStringView> fields = QStringView(line).split(u'\t');
+		bool idOk = false;
+		bool sizeOk = false;
+		PlanLine planLine;
+		if (fields.size() != 4)
+		{
+			return false;
+		}
+		planLine.id = fields[0].toUInt(&idOk);
+		planLine.size = fields[1].toLongLong(&sizeOk);
+		planLine.rules = VoiceMatcher::rulesFromNames(fields[2]);
+		if (!idOk || !sizeOk)
+		{
+			return false;
+		}
+		const QString sourcePath = fields[3].toString();
+		auto it = voiceFileBySourcePath.constFind(sourcePath);
+		if (it == voiceFileBySourcePath.constEnd())
+		{
+			it = voiceFileBySourcePath.insert(sourcePath, sourcePaths.size());
+			sourcePaths.append(sourcePath);
+		}
+		planLine.voiceFile = *it;
+		planLines.append(planLine);
+	}
+
+	// Le plan remplace tout ce que les étapes 1 à 3 avaient produit
+	const QString voiceRoot = voiceFolder.isEmpty() ? planVoiceFolderPath : voiceFolder;
+	matchingFiles.clear();
+	codecMismatchCount = 0;
+	outputGroups.clear();
+	invalidWemFiles.clear();
+	voiceLineIdsBySex.clear();
+	watchWemFilesByLineId.clear();
+	watchVoiceFilesByFolder.clear();
+	wemFiles.clear();
+	wemPaths.clear();
+	voiceFiles.clear();
+	voicePaths.clear();
+	stalePlanSources.clear();
+
+	voiceFiles.reserve(sourcePaths.size());
+	for (const QString& sourcePath : sourcePaths)
+	{
+		VoiceFile voiceFile;
+		voiceFile.path = voicePaths.add(QDir::isAbsolutePath(sourcePath) ? sourcePath : voiceRoot + "/" + sourcePath);
+		voiceFiles.append(voiceFile);
+	}
+	voiceMatcher.index(voiceFiles, voicePaths);
+
+	// Les listes ne bougent plus une fois remplies : les pointeurs de MatchingFile et OutputGroup restent valides
+	wemFiles.reserve(planLines.size());
+	for (const PlanLine& planLine : planLines)
+	{
+		WemFile wemFile;
+		wemFile.path = wemPaths.add(QString::number(planLine.id) + ".wem");
+		wemFile.id = planLine.id;
+		wemFiles.append(wemFile);
+	}
+	matchingFiles.reserve(planLines.size());
+	for (qsizetype i = 0; i < planLines.size(); i++)
+	{
+		MatchingFile matchingFile;
+		matchingFile.wemFile = &wemFiles[i];
+		matchingFile.found = true;
+		matchingFile.voiceFile = &voiceFiles[planLines[i].voiceFile];
+		matchingFile.rules = planLines[i].rules;
+		matchingFiles.append(matchingFile);
+	}
+
+	// Un groupe par source, comme planOutputs() les avait dédupliqués avant l'écriture du plan
+	QList<OutputGroup> plannedGroups(voiceFiles.size());
+	for (qsizetype i = 0; i < planLines.size(); i++)
+	{
+		OutputGroup& outputGroup = plannedGroups[planLines[i].voiceFile];
+		outputGroup.size = planLines[i].size;
+		outputGroup.matchingFiles.append(&matchingFiles[i]);
+	}
+	for (qsizetype i = 0; i < voiceFiles.size(); i++)
+	{
+		plannedGroups[i].sourcePath = voicePaths.filePath(voiceFiles[i].path);
+	}
+
+	// Une source modifiée depuis la planification n'est pas copiée
+	QtConcurrent::blockingMap(plannedGroups,
+		[](OutputGroup& outputGroup)
+		{
+			const QFileInfo source(outputGroup.sourcePath);
+			if (!source.exists() || source.size() != outputGroup.size)
+			{
+				outputGroup.size = -1;
+			}
+			outputGroup.sourceLocation = fileLocation(outputGroup.sourcePath);
+		}
+	);
+	for (const OutputGroup& outputGroup : plannedGroups)
+	{
+		if (outputGroup.size < 0)
+		{
+			stalePlanSources.append(outputGroup.sourcePath);
+		}
+		else
+		{
+			outputGroups.append(outputGroup);
+		}
+	}
+	sortOutputGroups();
+	return true;
+}
+
+Frenchiser::ReplaceResult Frenchiser::replaceVoice(const MatchingFile& matchingFile, const QString& outputFolder) const
+{
+	return replaceFile(voicePaths.filePath(matchingFile.voiceFile->path), outputFolder + "/" + QString::number(matchingFile.wemFile->id) + ".wem", false);
+}
+
+qint64 Frenchiser::replaceVoiceGroup(const OutputGroup& outputGroup, const QString& outputFolder) const
+{
+	Trace::Span span("replaceVoiceGroup", Trace::File, outputGroup.sourcePath);
+	qint64 writtenBytes = 0;
+	QString primaryPath;
+	for (const MatchingFile* matchingFile : outputGroup.matchingFiles)
+	{
+		progress.add();
+		const unsigned int id = matchingFile->wemFile->id;
+		const QString outputPath = outputFolder + "/" + QString::number(id) + ".wem";
+		// Déjà en place d'après le journal de la copie reprise : ni stat ni comparaison
+		if (copyJournal.contains(id))
+		{
+			resumedCount++;
+			if (primaryPath.isEmpty())
+			{
+				primaryPath = outputPath;
+			}
+			continue;
+		}
+
+		ReplaceResult result = ReplaceFailed;
+		qint64 fileBytes = 0;
+		if (primaryPath.isEmpty())
+		{
+			result = replaceFile(outputGroup.sourcePath, outputPath, false, &fileBytes);
+			if (result != ReplaceFailed)
+			{
+				primaryPath = outputPath;
+			}
+		}
+		else
+		{
+			result = replaceFile(primaryPath, outputPath, true, &fileBytes);
+		}
+		writtenBytes += fileBytes;
+		if (result != ReplaceFailed && copyJournal.isOpen())
+		{
+			copyJournal.append(id, outputPath);
+		}
+	}
+	return writtenBytes;
+}
+
+qsizetype Frenchiser::getResumableCount(const QString& outputFolder) const
+{
+	if (!CopyJournal::exists(outputFolder))
+	{
+		return 0;
+	}
+	CopyJournal journal;
+	return journal.load(outputFolder, outputPlanKey()) ? journal.size() : 0;
+}
+
+void Frenchiser::replaceVoices(const QString& outputFolder, bool resume) const
+{
+	const QByteArray planKey = outputPlanKey();
+	resume = resume && copyJournal.load(outputFolder, planKey);
+	// Sans journal (dossier en lecture seule...), la copie se fait quand même, sans reprise possible
+	copyJournal.open(outputFolder, planKey, resume);
+
+	CopyScheduler scheduler(options.copyThreads);
+	copyStats = scheduler.run(outputGroups.size(),
+		[this, &outputFolder](qsizetype index)
+		{
+			// Le débit mesuré est celui des écritures : une sortie déjà à jour ne compte pas
+			return replaceVoiceGroup(outputGroups[index], outputFolder);
+		},
+		canceled
+	);
+
+	if (isCanceled())
+	{
+		copyJournal.close();
+	}
+	else
+	{
+		copyJournal.remove();
+	}
+}
+
+QByteArray Frenchiser::outputPlanKey() const
+{
+	// Triées par id : la clé ne dépend pas de l'ordre des groupes sur le disque
+	QList<std::pair<unsigned int, const OutputGroup*>> outputs;
+	for (const OutputGroup& outputGroup : outputGroups)
+	{
+		for (const MatchingFile* matchingFile : outputGroup.matchingFiles)
+		{
+			outputs.append({ matchingFile->wemFile->id, &outputGroup });
+		}
+	}
+	std::sort(outputs.begin(), outputs.end(),
+		[](const std::pair<unsigned int, const OutputGroup*>& left, const std::pair<unsigned int, const OutputGroup*>& right)
+		{
+			return left.first < right.first;
+		}
+	);
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	for (const std::pair<unsigned int, const OutputGroup*>& output : outputs)
+	{
+		hash.addData(QByteArray::number(output.first) + '\t' + QByteArray::number(output.second->size) + '\t' + output.second->sourcePath.toUtf8() + '\n');
+	}
+	return hash.result();
+}
+
+QString Frenchiser::packagePath(const QString& outputFolder)
+{
+	return outputFolder + "/" + packageFileName;
+}
+
+bool Frenchiser::writePackage(const QString& packagePath) const
+{
+	Trace::Span span("writePackage", Trace::Stage, packagePath);
+	// Les sorties d'un même groupe partagent un seul contenu dans le package
+	WwisePackageWriter writer;
+	qsizetype outputCount = 0;
+	for (const OutputGroup& outputGroup : outputGroups)
+	{
+		const qsizetype data = writer.addData(outputGroup.size);
+		for (const MatchingFile* matchingFile : outputGroup.matchingFiles)
+		{
+			writer.addStream(matchingFile->wemFile->id, data);
+		}
+		outputCount += outputGroup.matchingFiles.size();
+	}
+
+	// Un lot est lu sur le pool pendant que ce thread écrit le précédent : la mémoire reste bornée
+	// et le package est écrit d'un bout à l'autre, sans retour en arrière
+	const qsizetype batchSize = qsizetype(qMax(1, QThread::idealThreadCount())) * 16;
+	const auto readBatch = [this, batchSize](qsizetype begin)
+	{
+		return QtConcurrent::mapped(outputGroups.constBegin() + begin, outputGroups.constBegin() + qMin(begin + batchSize, outputGroups.size()),
+			[](const OutputGroup& outputGroup)
+			{
+				Trace::Span readSpan("readSource", Trace::File, outputGroup.sourcePath);
+				QFile file(outputGroup.sourcePath);
+				return file.open(QFile::ReadOnly) ? file.readAll() : QByteArray();
+			}
+		);
+	};
+
+	packageError.clear();
+	bool written = writer.open(packagePath);
+	qint64 byteCount = 0;
+	qint64 duplicateByteCount = 0;
+	QFuture<QByteArray> batch = readBatch(0);
+	for (qsizetype begin = 0; written && begin < outputGroups.size(); begin += batchSize)
+	{
+		QList<QByteArray> contents;
+		{
+			// Attente du lot en cours de lecture : les trous du thread d'écriture
+			Trace::Span waitSpan("waitBatch", Trace::Stage);
+			contents = batch.results();
+		}
+		if (begin + batchSize < outputGroups.size())
+		{
+			batch = readBatch(begin + batchSize);
+		}
+		for (qsizetype i = 0; written && i < contents.size(); i++)
+		{
+			const OutputGroup& outputGroup = outputGroups[begin + i];
+			// Une source modifiée depuis planOutputs() n'a plus la taille annoncée dans l'en-tête
+			written = !isCanceled() && writer.writeData(contents[i]);
+			if (!written && !isCanceled())
+			{
+				packageError = writer.errorString() + " : " + outputGroup.sourcePath;
+			}
+			byteCount += outputGroup.size;
+			duplicateByteCount += outputGroup.size * (outputGroup.matchingFiles.size() - 1);
+			progress.add(outputGroup.matchingFiles.size());
+		}
+	}
+	batch.waitForFinished();
+	written = written && writer.commit();
+
+	if (!written)
+	{
+		if (isCanceled())
+		{
+			packageError = QObject::tr("Annulé");
+		}
+		else if (packageError.isEmpty())
+		{
+			packageError = writer.errorString();
+		}
+		replaceCounts[ReplaceFailed] += int(outputCount);
+		return false;
+	}
+	replaceCounts[Copied] += int(outputCount);
+	writtenByteCount += byteCount;
+	dedupFileCount += int(outputCount - outputGroups.size());
+	dedupByteCount += duplicateByteCount;
+	return true;
+}
+
+Frenchiser::ReplaceResult Frenchiser::replaceFile(const QString& sourcePath, const QString& outputPath, bool duplicate, qint64* writtenBytes) const
+{
+	const QFileInfo source(sourcePath);
+	const QFileInfo output(outputPath);
+
+	// La sortie garde la date de modification de la source : même taille et même date = déjà à jour
+	ReplaceResult result = Copied;
+	if (output.exists())
+	{
+		if (output.size() == source.size() && output.lastModified() == source.lastModified())
+		{
+			replaceCounts[Unchanged]++;
+			return Unchanged;
+		}
+		if (!QFile::remove(outputPath))
+		{
+			replaceCounts[ReplaceFailed]++;
+			return ReplaceFailed;
+		}
+		result = Updated;
+	}
+
+	Trace::Span copySpan(duplicate ? "copyDuplicate" : "copy", Trace::Operation);
+	// Écrite sous un nom temporaire puis renommée : un <id>.wem présent est toujours complet,
+	// même après un arrêt en pleine copie
+	const QString partPath = outputPath + ".part";
+	QFile::remove(partPath);
+	const FileMaterializer::Strategy strategy = duplicate
+		? materializer.materializeDuplicate(sourcePath, partPath)
+		: materializer.materialize(sourcePath, partPath);
+	if (strategy == FileMaterializer::StrategyCount)
+	{
+		replaceCounts[ReplaceFailed]++;
+		return ReplaceFailed;
+	}
+	if (strategy != FileMaterializer::Hardlink)
+	{
+		// Le journal synchronise les sorties par lots ; syncEachOutput le fait ici, avant le renommage
+		QFile outputFile(partPath);
+		if (!outputFile.open(QFile::ReadWrite)
+			|| !outputFile.setFileTime(source.lastModified(), QFileDevice::FileModificationTime)
+			|| (options.syncEachOutput && !CopyJournal::syncFile(outputFile)))
+		{
+			outputFile.close();
+			QFile::remove(partPath);
+			replaceCounts[ReplaceFailed]++;
+			return ReplaceFailed;
+		}
+		outputFile.close();
+	}
+	if (!QFile::rename(partPath, outputPath))
+	{
+		QFile::remove(partPath);
+		replaceCounts[ReplaceFailed]++;
+		return ReplaceFailed;
+	}
+	if (strategy != FileMaterializer::Hardlink)
+	{
+		writtenByteCount += source.size();
+		if (writtenBytes)
+		{
+			*writtenBytes = source.size();
+		}
+	}
+	if (duplicate && (strategy == FileMaterializer::Hardlink || strategy == FileMaterializer::Reflink))
+	{
+		dedupFileCount++;
+		dedupByteCount += source.size();
+	}
+
+	replaceCounts[result]++;
+	return result;
+}
+
+int Frenchiser::removeStaleOutputs(const QString& outputFolder) const
+{
+	QSet<QString> outputFileNames;
+	for (const MatchingFile& matchingFile : matchingFiles)
+	{
+		if (matchingFile.found && !(matchingFile.codecMismatch && options.skipCodecMismatches))
+		{
+			outputFileNames.insert(QString::number(matchingFile.wemFile->id) + ".wem");
+		}
+	}
+
+	// On ne touche qu'aux <id>.wem, les autres fichiers du dossier ne sont pas à nous
+	int removed = 0;
+	QDir dir(outputFolder);
+	for (const QString& fileName : dir.entryList(QStringList() << "*.wem", QDir::Files))
+	{
+		bool isId = false;
+		QStringView(fileName).chopped(4).toUInt(&isId);
+		if (isId && !outputFileNames.contains(fileName) && dir.remove(fileName))
+		{
+			removed++;
+		}
+	}
+	return removed;
+}
+
+Frenchiser::WatchUpdate Frenchiser::updateVoiceFolders(const QStringList& folderPaths, const QString& outputFolder, bool sync)
+{
+	Trace::Span span("updateVoiceFolders", Trace::Stage);
+	WatchUpdate result;
+	if (matchingFiles.size() != wemFiles.size())
+	{
+		// L'étape 3 n'a pas tourné sur les listes actuelles
+		return result;
+	}
+	if (watchWemFilesByLineId.isEmpty())
+	{
+		const QList<QString> lineIds = QtConcurrent::blockingMapped<QList<QString>>(wemFiles,
+			[this](const WemFile& wemFile)
+			{
+				return getFullLineId(wemPaths.filePath(wemFile.path));
+			}
+		);
+		for (qsizetype i = 0; i < lineIds.size(); i++)
+		{
+			watchWemFilesByLineId[lineIds[i]].append(i);
+		}
+	}
+	if (watchVoiceFilesByFolder.isEmpty())
+	{
+		for (qsizetype i = 0; i < voiceFiles.size(); i++)
+		{
+			if (!voiceFiles[i].removed)
+			{
+				watchVoiceFilesByFolder[voicePaths.directory(voiceFiles[i].path).toString()].append(i);
+			}
+		}
+	}
+
+	// Comparaison de chaque dossier avec ce que l'index en connaît
+	QSet<qsizetype> changedVoiceFiles;
+	QSet<QString> changedLineIds;
+	QList<VoiceFile> addedVoiceFiles;
+	for (const QString& folderPath : folderPaths)
+	{
+		QHash<QString, QFileInfo> presentFiles;
+		for (const QFileInfo& fileInfo : QDir(folderPath).entryInfoList(QStringList() << "*.mp3" << "*.wem", QDir::Files))
+		{
+			presentFiles.insert(fileInfo.fileName(), fileInfo);
+		}
+
+		QList<qsizetype>& folderVoiceFiles = watchVoiceFilesByFolder[folderPath];
+		QList<qsizetype> keptVoiceFiles;
+		for (const qsizetype voiceIndex : folderVoiceFiles)
+		{
+			VoiceFile& voiceFile = voiceFiles[voiceIndex];
+			const QString filePath = voicePaths.filePath(voiceFile.path);
+			const auto it = presentFiles.constFind(voicePaths.fileName(voiceFile.path).toString());
+			if (it == presentFiles.constEnd())
+			{
+				// Supprimée : elle garde sa place dans la liste mais sort de l'index et des rapports
+				voiceMatcher.remove(quint32(voiceIndex), filePath);
+				voiceFile.removed = true;
+				voiceByteCount -= voiceFile.size;
+			}
+			else
+			{
+				keptVoiceFiles.append(voiceIndex);
+				const bool modified = it->size() != voiceFile.size || it->lastModified().toMSecsSinceEpoch() != voiceFile.lastModified;
+				presentFiles.erase(it);
+				if (!modified)
+				{
+					continue;
+				}
+				// probeVoiceFile() ajoute la nouvelle taille
+				voiceByteCount -= voiceFile.size;
+				probeVoiceFile(filePath, voiceFile);
+			}
+			changedVoiceFiles.insert(voiceIndex);
+			changedLineIds.insert(getFullLineId(filePath));
+		}
+		for (auto it = presentFiles.constBegin(); it != presentFiles.constEnd(); ++it)
+		{
+			const QString filePath = folderPath + "/" + it.key();
+			VoiceFile voiceFile;
+			voiceFile.path = voicePaths.add(filePath);
+			probeVoiceFile(filePath, voiceFile);
+			keptVoiceFiles.append(voiceFiles.size() + addedVoiceFiles.size());
+			addedVoiceFiles.append(voiceFile);
+			changedLineIds.insert(getFullLineId(filePath));
+		}
+		folderVoiceFiles = keptVoiceFiles;
+	}
+	result.voiceFileCount = int(changedVoiceFiles.size() + addedVoiceFiles.size());
+
+	// Les correspondances pointent dans voiceFiles : elles sont refaites si la liste a été déplacée
+	if (!addedVoiceFiles.isEmpty())
+	{
+		QList<qsizetype> matchedVoiceFiles(matchingFiles.size(), -1);
+		for (qsizetype i = 0; i < matchingFiles.size(); i++)
+		{
+			if (matchingFiles[i].voiceFile)
+			{
+				matchedVoiceFiles[i] = matchingFiles[i].voiceFile - voiceFiles.constData();
+			}
+		}
+		const qsizetype firstAdded = voiceFiles.size();
+		voiceFiles.append(addedVoiceFiles);
+		for (qsizetype i = 0; i < matchingFiles.size(); i++)
+		{
+			if (matchedVoiceFiles[i] >= 0)
+			{
+				matchingFiles[i].voiceFile = &voiceFiles[matchedVoiceFiles[i]];
+			}
+		}
+		for (qsizetype i = firstAdded; i < voiceFiles.size(); i++)
+		{
+			voiceMatcher.insert(quint32(i), voicePaths.filePath(voiceFiles[i].path));
+		}
+	}
+
+	QSet<qsizetype> affectedWemFiles;
+	for (const QString& lineId : changedLineIds)
+	{
+		for (const qsizetype wemIndex : watchWemFilesByLineId.value(lineId))
+		{
+			affectedWemFiles.insert(wemIndex);
+		}
+	}
+	for (qsizetype i = 0; i < matchingFiles.size(); i++)
+	{
+		if (matchingFiles[i].voiceFile && changedVoiceFiles.contains(matchingFiles[i].voiceFile - voiceFiles.constData()))
+		{
+			affectedWemFiles.insert(i);
+		}
+	}
+	result.wemFileCount = int(affectedWemFiles.size());
+
+	// Chaque wem touché n'écrit que sa propre sortie : rien n'est partagé entre les threads
+	const QList<qsizetype> wemIndices(affectedWemFiles.constBegin(), affectedWemFiles.constEnd());
+	std::atomic<int> removed { 0 };
+	QtConcurrent::blockingMap(wemIndices.constBegin(), wemIndices.constEnd(),
+		[this, &outputFolder, sync, &removed](qsizetype wemIndex)
+		{
+			MatchingFile& matchingFile = matchingFiles[wemIndex];
+			matchingFile = s3ProcessVoice(wemFiles[wemIndex]);
+			if (options.packedOutput)
+			{
+				return;
+			}
+			if (matchingFile.found && !(matchingFile.codecMismatch && options.skipCodecMismatches))
+			{
+				replaceVoice(matchingFile, outputFolder);
+				return;
+			}
+			const QString outputPath = outputFolder + "/" + QString::number(matchingFile.wemFile->id) + ".wem";
+			if (sync && QFile::exists(outputPath) && QFile::remove(outputPath))
+			{
+				removed++;
+			}
+		}
+	);
+	result.removedCount = removed;
+	codecMismatchCount = int(std::count_if(matchingFiles.constBegin(), matchingFiles.constEnd(),
+		[](const MatchingFile& matchingFile)
+		{
+			return matchingFile.codecMismatch;
+		}
+	));
+
+	// Le package se réécrit en entier ; les groupes de sortie ne valent plus pour des <id>.wem isolés
+	if (options.packedOutput && result.wemFileCount > 0)
+	{
+		planOutputs();
+		writePackage(packagePath(outputFolder));
+	}
+	else if (!options.packedOutput)
+	{
+		outputGroups.clear();
+	}
+	return result;
+}
+
+void Frenchiser::resetReplaceCounts()
+{
+	materializer.resetCounts();
+	dedupFileCount = 0;
+	dedupByteCount = 0;
+	writtenByteCount = 0;
+	resumedCount = 0;
+	copyStats = CopyScheduler::Stats();
+	for (std::atomic<int>& replaceCount : replaceCounts)
+	{
+		replaceCount = 0;
+	}
+}
+
+void Frenchiser::writeTxtpErrorsLog() const
+{
+	QFile txtpErrorsLog("logs/txtpErrors.log");
+	if (txtpErrorsLog.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		QTextStream out(&txtpErrorsLog);
+		for (const WemFile& wemFile : invalidWemFiles)
+		{
+			out << wemFile.error << "\t" << wemPaths.filePath(wemFile.path) << '\n';
+		}
+		txtpErrorsLog.close();
+	}
+}
+
+void Frenchiser::writeStalePlanLog() const
+{
+	QFile stalePlanLog("logs/stalePlanSources.log");
+	if (stalePlanLog.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		QTextStream out(&stalePlanLog);
+		for (const QString& sourcePath : stalePlanSources)
+		{
+			out << sourcePath << '\n';
+		}
+		stalePlanLog.close();
+	}
+}
+
+void Frenchiser::writeFrenchFilesLog(const QString& inputFolder) const
+{
+	QFile frenchFilesLog("logs/frenchFiles.log");
+	if (frenchFilesLog.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		QTextStream out(&frenchFilesLog);
+		const QString inputPrefix = inputFolder + "/";
+		for (const VoiceFile& voiceFile : voiceFiles)
+		{
+			if (voiceFile.removed)
+			{
+				continue;
+			}
+			QString shortFilePath = voicePaths.filePath(voiceFile.path);
+			shortFilePath.replace(inputPrefix, "");
+			out << voicePaths.fileName(voiceFile.path) << "\t\t\t" << shortFilePath << '\n';
+		}
+		frenchFilesLog.close();
+	}
+}
+
+void Frenchiser::writeMatchingLogs() const
+{
+	// Un seul passage sur les txtp pour les quatre premiers rapports, puis un sur les voix ;
+	// '\n' plutôt que Qt::endl pour ne pas vider le tampon à chaque ligne
+	QFile foundFilesLog("logs/foundFiles.log");
+	QFile fuzzyFilesLog("logs/fuzzyFiles.log");
+	QFile missingFilesLog("logs/missingFiles.log");
+	QFile missingFilesIdFoundLog("logs/missingFilesIdFound.log");
+	QFile codecMismatchesLog("logs/codecMismatches.log");
+	foundFilesLog.open(QFile::WriteOnly | QFile::Text);
+	fuzzyFilesLog.open(QFile::WriteOnly | QFile::Text);
+	missingFilesLog.open(QFile::WriteOnly | QFile::Text);
+	missingFilesIdFoundLog.open(QFile::WriteOnly | QFile::Text);
+	codecMismatchesLog.open(QFile::WriteOnly | QFile::Text);
+	QTextStream foundOut(&foundFilesLog);
+	QTextStream fuzzyOut(&fuzzyFilesLog);
+	QTextStream missingOut(&missingFilesLog);
+	QTextStream missingIdFoundOut(&missingFilesIdFoundLog);
+	QTextStream codecMismatchOut(&codecMismatchesLog);
+
+	QSet<const VoiceFile*> usedVoiceFiles;
+	usedVoiceFiles.reserve(matchingFiles.size());
+	for (const MatchingFile& matchingFile : matchingFiles)
+	{
+		const QStringView wemFileName = wemPaths.fileName(matchingFile.wemFile->path);
+		if (matchingFile.voiceFile)
+		{
+			usedVoiceFiles.insert(matchingFile.voiceFile);
+		}
+
+		if (matchingFile.found)
+		{
+			const QStringView voiceFileName = voicePaths.fileName(matchingFile.voiceFile->path);
+			foundOut << wemFileName << "\t" << voiceFileName << "\t" << matchingFile.wemFile->id << '\n';
+			if (matchingFile.confidence < 1.0f)
+			{
+				fuzzyOut << wemFileName << "\t" << voiceFileName << "\t" << matchingFile.wemFile->id << "\t" << QString::number(matchingFile.confidence, 'f', 2) << '\n';
+			}
+			if (matchingFile.codecMismatch)
+			{
+				const VoiceFile& voiceFile = *matchingFile.voiceFile;
+				codecMismatchOut << matchingFile.wemFile->id << "\t" << matchingFile.wemFile->codec << "\t" << AudioProbe::codecName(voiceFile.codec)
+					<< "\t" << voiceFile.sampleRate << " Hz\t" << int(voiceFile.channels) << " canal(aux)\t" << voiceFile.durationMs << " ms\t"
+					<< voicePaths.filePath(voiceFile.path) << '\n';
+			}
+			continue;
+		}
+
+		missingOut << wemFileName << "\t[" << matchingFile.wemFile->id << "]" << '\n';
+		const QString wemFilePath = wemPaths.filePath(matchingFile.wemFile->path);
+		const QString lineId = getFullLineId(wemFilePath);
+		if (voiceLineIdsBySex.contains(getSex(wemFilePath) + lineId))
+		{
+			missingIdFoundOut << lineId << "\t" << wemFileName << "\t[" << matchingFile.wemFile->id << "]" << '\n';
+		}
+	}
+	foundOut.flush();
+	fuzzyOut.flush();
+	missingOut.flush();
+	missingIdFoundOut.flush();
+	codecMismatchOut.flush();
+
+	QFile voicesFilesNotFound("logs/voicesFilesNotFound.log");
+	if (voicesFilesNotFound.open(QFile::WriteOnly | QFile::Text))
+	{
+		QTextStream out(&voicesFilesNotFound);
+		for (const VoiceFile& voiceFile : voiceFiles)
+		{
+			if (!voiceFile.removed && !usedVoiceFiles.contains(&voiceFile))
+			{
+				const QString filePath = voicePaths.filePath(voiceFile.path);
+				out << VoiceMatcher::voiceName(filePath) << "\t" << filePath << '\n';
+			}
+		}
+	}
+}
+
+void Frenchiser::writeRunReport() const
+{
+	QJsonObject s1;
+	s1["txtpFiles"] = wemFiles.size();
+	s1["invalidFiles"] = invalidWemFiles.size();
+	s1["bytes"] = txtpByteCount.load();
+	QHash<QString, int> errorCounts;
+	for (const WemFile& wemFile : invalidWemFiles)
+	{
+		errorCounts[wemFile.error]++;
+	}
+	QJsonObject parseErrors;
+	for (auto it = errorCounts.constBegin(); it != errorCounts.constEnd(); ++it)
+	{
+		parseErrors[it.key()] = it.value();
+	}
+	s1["parseErrors"] = parseErrors;
+
+	QJsonObject s2;
+	qsizetype voiceFileCount = 0;
+	int voiceCodecCounts[AudioProbe::CodecCount] = {};
+	for (const VoiceFile& voiceFile : voiceFiles)
+	{
+		if (!voiceFile.removed)
+		{
+			voiceFileCount++;
+			voiceCodecCounts[voiceFile.codec]++;
+		}
+	}
+	s2["voiceFiles"] = voiceFileCount;
+	s2["bytes"] = voiceByteCount.load();
+	QJsonObject voiceCodecs;
+	for (int i = 0; i < AudioProbe::CodecCount; i++)
+	{
+		if (voiceCodecCounts[i] > 0)
+		{
+			voiceCodecs[AudioProbe::codecName(AudioProbe::Codec(i))] = voiceCodecCounts[i];
+		}
+	}
+	s2["codecs"] = voiceCodecs;
+
+	// Une correspondance peut cumuler plusieurs règles : "_alt01" retiré puis race remplacée
+	int missing = 0;
+	int exactCount = 0, replaceCount = 0, subFolderCount = 0, raceCount = 0, fuzzyCount = 0;
+	QHash<QString, int> raceCounts;
+	for (const MatchingFile& matchingFile : matchingFiles)
+	{
+		if (!matchingFile.found)
+		{
+			missing++;
+			continue;
+		}
+		exactCount += (matchingFile.rules & VoiceMatcher::ExactRule) ? 1 : 0;
+		replaceCount += (matchingFile.rules & VoiceMatcher::ReplaceRule) ? 1 : 0;
+		subFolderCount += (matchingFile.rules & VoiceMatcher::SubFolderRule) ? 1 : 0;
+		fuzzyCount += (matchingFile.rules & VoiceMatcher::FuzzyRule) ? 1 : 0;
+		if (matchingFile.rules & VoiceMatcher::RaceRule)
+		{
+			raceCount++;
+			raceCounts[voiceMatcher.raceTargetName(matchingFile.race, matchingFile.raceTarget)]++;
+		}
+	}
+	QJsonObject rules;
+	rules["exact"] = exactCount;
+	rules["replace"] = replaceCount;
+	rules["subFolder"] = subFolderCount;
+	rules["race"] = raceCount;
+	rules["fuzzy"] = fuzzyCount;
+	QJsonObject races;
+	for (auto it = raceCounts.constBegin(); it != raceCounts.constEnd(); ++it)
+	{
+		races[it.key()] = it.value();
+	}
+
+	QJsonObject copy;
+	copy["copied"] = getReplaceCount(Copied);
+	copy["updated"] = getReplaceCount(Updated);
+	copy["unchanged"] = getReplaceCount(Unchanged);
+	copy["failed"] = getReplaceCount(ReplaceFailed);
+	copy["resumed"] = getResumedCount();
+	if (!packageError.isEmpty())
+	{
+		copy["packageError"] = packageError;
+	}
+	copy["bytes"] = writtenByteCount.load();
+	const qint64 copyMs = runReport.getTiming(RunReport::S3Copy).wallMs;
+	copy["mbPerSecond"] = copyMs > 0 ? double(writtenByteCount) / (1024.0 * 1024.0) / (double(copyMs) / 1000.0) : 0.0;
+	copy["dedupFiles"] = getDedupFileCount();
+	copy["dedupBytes"] = getDedupByteCount();
+	QJsonObject strategies;
+	for (int i = FileMaterializer::Hardlink; i < FileMaterializer::StrategyCount; i++)
+	{
+		strategies[FileMaterializer::strategyName(FileMaterializer::Strategy(i))] = materializer.getCount(FileMaterializer::Strategy(i));
+	}
+	copy["strategies"] = strategies;
+	QJsonObject threads;
+	threads["initial"] = copyStats.initialThreads;
+	threads["min"] = copyStats.minThreads;
+	threads["max"] = copyStats.maxThreads;
+	threads["final"] = copyStats.finalThreads;
+	threads["best"] = copyStats.bestThreads;
+	threads["bestMbPerSecond"] = copyStats.bestMbPerSecond;
+	threads["adaptive"] = options.copyThreads <= 0;
+	copy["threads"] = threads;
+
+	QJsonObject s3;
+	s3["matched"] = matchingFiles.size() - missing;
+	s3["missing"] = missing;
+	s3["codecMismatches"] = codecMismatchCount;
+	s3["codecMismatchesSkipped"] = options.skipCodecMismatches;
+	s3["rules"] = rules;
+	s3["races"] = races;
+	s3["copy"] = copy;
+
+	QJsonObject report;
+	report["timings"] = runReport.timingsJson();
+	report["s1"] = s1;
+	report["s2"] = s2;
+	report["s3"] = s3;
+	RunReport::writeJson("logs/runReport.json", report);
+	RunReport::writeCsv("logs/runReport.csv", report);
+	if (Trace::isEnabled())
+	{
+		Trace::writeJson("logs/trace.json");
+	}
+}
@@ -0,0 +1,254 @@
+#ifndef FRENCHISER_H
+#define FRENCHISER_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include "AudioProbe.h"
+#include "CopyJournal.h"
+#include "CopyScheduler.h"
+#include "FileMaterializer.h"
+#include "PathPool.h"
+#include "Progress.h"
+#include "RunReport.h"
+#include "ScanCache.h"
+#include "VoiceFile.h"
+#include "VoiceMatcher.h"
+
+#include <atomic>
+
+class QSettings;
+
+// Les chemins sont dans le PathPool du moteur : getWemFilePath()/getVoiceFilePath()
+struct WemFile
+{
+	PathPool::Id path = 0;
+	unsigned int id = 0;
+	QString codec;
+	QString error;
+};
+
+struct MatchingFile
+{
+	const WemFile* wemFile = nullptr;
+	bool found = false;
+	const VoiceFile* voiceFile = nullptr;
+	float confidence = 1.0f;
+	// Combinaison de VoiceMatcher::Rule, pour le rapport de lancement
+	quint8 rules = 0;
+	qint16 race = -1;
+	qint16 raceTarget = -1;
+	// La VF n'est pas dans le codec attendu par le txtp (MP3 à la place d'un wem Vorbis...)
+	bool codecMismatch = false;
+};
+
+// Sorties qui partagent le même contenu : une seule écriture depuis la source,
+// les autres <id>.wem sont des liens ou des clones de la première
+struct OutputGroup
+{
+	QString sourcePath;
+	qint64 size = 0;
+	// Inode de la source : les copies partent dans cet ordre, les lectures suivent le disque
+	quint64 sourceLocation = 0;
+	QByteArray contentHash;
+	QList<const MatchingFile*> matchingFiles;
+};
+
+// Moteur commun aux deux interfaces (fenêtre et ligne de commande) :
+// indexation des txtp, des voix françaises, correspondance et copie.
+class Frenchiser
+{
+public:
+	enum ReplaceResult
+	{
+		Copied,
+		Updated,
+		Unchanged,
+		ReplaceFailed,
+		ReplaceResultCount
+	};
+
+	// Bilan d'une mise à jour du mode surveillance
+	struct WatchUpdate
+	{
+		// VF ajoutées, modifiées ou supprimées
+		int voiceFileCount = 0;
+		// wem dont la correspondance a été refaite
+		int wemFileCount = 0;
+		// <id>.wem supprimés faute de voix (avec sync)
+		int removedCount = 0;
+	};
+
+	// Réglages de l'étape 3, figés avant de lancer les threads : ceux-ci ne lisent jamais l'interface
+	struct Options
+	{
+		bool fuzzyMatching = false;
+		// Les VF dont le codec ne convient pas sont signalées ; avec ceci, elles ne sont pas copiées
+		bool skipCodecMismatches = false;
+		FileMaterializer::Strategy outputStrategy = FileMaterializer::Auto;
+		// Écritures simultanées de l'étape de copie ; 0 : adaptatif (CopyScheduler)
+		int copyThreads = 0;
+		// Toutes les sorties dans un seul package (packagePath()) au lieu d'un <id>.wem chacune
+		bool packedOutput = false;
+		// Chaque sortie sur le disque avant son renommage, même hors journal (mode surveillance) ;
+		// sinon la synchronisation se fait par lots de journal, bien moins coûteuse
+		bool syncEachOutput = false;
+	};
+
+	Frenchiser();
+
+	void setOptions(const Options& options);
+	const Options& getOptions() const { return options; }
+	// Fichiers analysés (étapes 1 et 2), txtp comparés, sorties écrites : remis à zéro par l'appelant
+	Progress& getProgress() const { return progress; }
+
+	void cancel();
+	void resetCancel();
+	bool isCanceled() const;
+
+	static QString defaultCacheFolder(const QSettings& settings);
+	void loadCaches(const QString& cacheFolder);
+	void saveTxtpCache();
+	void saveVoiceCache();
+
+	// Suffixes du type ".bnk"
+	QStringList getFilesInFolder(const QString& folderPath, const QStringList& fileSuffixes) const;
+	const QHash<QString, QVector<QString>>& getCorrespondingRaces() const { return correspondingRaces; }
+	QString getLineId(const QString& filePath) const;
+	QString getFullLineId(const QString& filePath) const;
+	QChar getSex(const QString& filePath) const;
+
+	// Parcours et analyse en un seul passage, sur plusieurs threads
+	QList<WemFile> s1ProcessFolder(const QString& folderPath) const;
+	WemFile s1ProcessFile(const QString& filePath) const;
+	QList<WemFile> s1ProcessBankFolder(const QString& folderPath) const;
+	void setWemFiles(QList<WemFile> wemFiles);
+	const QList<WemFile>& getWemFiles() const { return wemFiles; }
+	const QList<WemFile>& getInvalidWemFiles() const { return invalidWemFiles; }
+	QString getWemFilePath(const WemFile& wemFile) const { return wemPaths.filePath(wemFile.path); }
+
+	QList<VoiceFile> s2ProcessVoiceFolder(const QString& folderPath) const;
+	VoiceFile s2ProcessVoiceFile(const QString& filePath) const;
+	void setVoiceFiles(QList<VoiceFile> voiceFiles);
+	const QList<VoiceFile>& getVoiceFiles() const { return voiceFiles; }
+	QString getVoiceFilePath(const VoiceFile& voiceFile) const { return voicePaths.filePath(voiceFile.path); }
+
+	MatchingFile s3ProcessVoice(const WemFile& wemFile) const;
+	void setMatchingFiles(const QList<MatchingFile>& matchingFiles);
+	const QList<MatchingFile>& getMatchingFiles() const { return matchingFiles; }
+	int getCodecMismatchCount() const { return codecMismatchCount; }
+	void planOutputs();
+	const QList<OutputGroup>& getOutputGroups() const { return outputGroups; }
+	// Plan de remplacement, une ligne "<id>\t<taille>\t<règles>\t<source>" par sortie,
+	// à relire plus tard (ou ailleurs) par loadPlan() sans refaire les étapes 1 à 3
+	bool writePlan(const QString& planPath, const QString& voiceFolder) const;
+	// voiceFolder vide : celui enregistré dans le plan. Les sources dont la taille a changé
+	// depuis ne sont pas reprises (getStalePlanSources)
+	bool loadPlan(const QString& planPath, const QString& voiceFolder);
+	const QStringList& getStalePlanSources() const { return stalePlanSources; }
+	ReplaceResult replaceVoice(const MatchingFile& matchingFile, const QString& outputFolder) const;
+	// Renvoie les octets réellement écrits : ni les sorties à jour, ni celles reprises du journal
+	qint64 replaceVoiceGroup(const OutputGroup& outputGroup, const QString& outputFolder) const;
+	// Sorties déjà écrites par une copie interrompue de ce même plan vers ce dossier (CopyJournal) ;
+	// 0 s'il n'y en a pas ou si le plan a changé depuis
+	qsizetype getResumableCount(const QString& outputFolder) const;
+	// Tous les groupes de getOutputGroups(), dans leur ordre, sur le pool du CopyScheduler ; bloquant.
+	// Avec resume, les sorties notées dans le journal d'une copie interrompue ne sont pas revérifiées
+	void replaceVoices(const QString& outputFolder, bool resume = false) const;
+	int getResumedCount() const { return resumedCount; }
+	const CopyScheduler::Stats& getCopyStats() const { return copyStats; }
+	static QString packagePath(const QString& outputFolder);
+	// Réécrit tout le package : sources lues sur le pool, écrites à la suite par ce thread.
+	// En cas d'échec, rien n'est remplacé et toutes les sorties comptent comme ReplaceFailed
+	bool writePackage(const QString& packagePath) const;
+	// Cause du dernier échec de writePackage() (aussi dans le rapport), vide s'il a réussi
+	const QString& getPackageError() const { return packageError; }
+	int getDedupFileCount() const { return dedupFileCount; }
+	qint64 getDedupByteCount() const { return dedupByteCount; }
+	int removeStaleOutputs(const QString& outputFolder) const;
+	const FileMaterializer& getMaterializer() const { return materializer; }
+	// Mode surveillance, après l'étape 3 : relit ces dossiers de VF (sans leurs sous-dossiers),
+	// met l'index à jour, puis ne refait la correspondance et l'écriture que pour les wem de même id
+	// de réplique qu'une VF ajoutée, modifiée ou supprimée, ou qui pointaient sur l'une d'elles
+	WatchUpdate updateVoiceFolders(const QStringList& folderPaths, const QString& outputFolder, bool sync);
+	void resetReplaceCounts();
+	int getReplaceCount(ReplaceResult replaceResult) const { return replaceCounts[replaceResult]; }
+
+	void writeTxtpErrorsLog() const;
+	void writeStalePlanLog() const;
+	void writeFrenchFilesLog(const QString& inputFolder) const;
+	void writeMatchingLogs() const;
+	// logs/runReport.json et logs/runReport.csv : durées, volumes et règles de correspondance
+	void writeRunReport() const;
+	// Les phases de l'étape 3 lancées par l'appelant (correspondance, copie) y sont chronométrées
+	RunReport& getRunReport() const { return runReport; }
+	qint64 getTxtpByteCount() const { return txtpByteCount; }
+	qint64 getVoiceByteCount() const { return voiceByteCount; }
+	qint64 getWrittenByteCount() const { return writtenByteCount; }
+
+private:
+	std::atomic<bool> canceled { false };
+	Options options;
+	mutable Progress progress;
+	mutable std::atomic<int> replaceCounts[ReplaceResultCount] = {};
+	mutable std::atomic<int> dedupFileCount { 0 };
+	mutable std::atomic<qint64> dedupByteCount { 0 };
+	mutable std::atomic<qint64> txtpByteCount { 0 };
+	mutable std::atomic<qint64> voiceByteCount { 0 };
+	mutable std::atomic<qint64> writtenByteCount { 0 };
+	mutable std::atomic<int> resumedCount { 0 };
+	mutable QString packageError;
+	mutable CopyScheduler::Stats copyStats;
+	mutable RunReport runReport;
+
+	// Groupes triés par emplacement de la source (sourceLocation), puis par chemin
+	void sortOutputGroups();
+	// Codec, taille et date d'une VF, depuis le cache si elle n'a pas changé
+	void probeVoiceFile(const QString& filePath, VoiceFile& voiceFile) const;
+	// writtenBytes : octets réellement écrits, 0 pour une sortie inchangée ou un lien physique
+	ReplaceResult replaceFile(const QString& sourcePath, const QString& outputPath, bool duplicate, qint64* writtenBytes = nullptr) const;
+	// Empreinte des sorties (id, taille et chemin de la source) : un journal n'est repris que pour le même plan
+	QByteArray outputPlanKey() const;
+
+	mutable FileMaterializer materializer;
+	mutable CopyJournal copyJournal;
+	mutable ScanCache txtpCache;
+	mutable ScanCache voiceCache;
+
+	QString internCodec(const QString& codec) const;
+	mutable QMutex codecsMutex;
+	mutable QStringList codecs;
+
+	const QHash<QString, QVector<QString>> correspondingRaces;
+	const QStringList subFolders;
+	const QHash<QString, QString> shittyReplace;
+
+	// Les analyses remplissent les pools "pending", repris par setWemFiles()/setVoiceFiles() :
+	// une analyse peut tourner pendant que les listes actuelles sont lues. setWemFiles(),
+	// setVoiceFiles() et loadPlan() remplacent listes et pools : l'appelant ne les appelle
+	// jamais pendant l'étape 3 ou une mise à jour de la surveillance, qui y suivent des pointeurs
+	mutable PathPool pendingWemPaths;
+	mutable PathPool pendingVoicePaths;
+	PathPool wemPaths;
+	PathPool voicePaths;
+
+	QList<WemFile> wemFiles;
+	QList<WemFile> invalidWemFiles;
+	QList<VoiceFile> voiceFiles;
+
+	VoiceMatcher voiceMatcher;
+	QList<MatchingFile> matchingFiles;
+	int codecMismatchCount = 0;
+	QList<OutputGroup> outputGroups;
+	QStringList stalePlanSources;
+	// Sexe suivi de l'id complet de réplique, pour missingFilesIdFound.log
+	QSet<QString> voiceLineIdsBySex;
+	// Mode surveillance : construits à la première mise à jour, vidés quand les listes changent
+	QHash<QString, QList<qsizetype>> watchWemFilesByLineId;
+	QHash<QString, QList<qsizetype>> watchVoiceFilesByFolder;
+};
+
+#endif // FRENCHISER_H
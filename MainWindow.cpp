@@ -5,31 +5,12 @@
 #include <QMessageBox>
 #include <QtConcurrent/QtConcurrent>
 
+#include <climits>
+
 MainWindow::MainWindow(QWidget* parent)
 	: QMainWindow(parent)
 	, ui(new Ui::MainWindow)
 	, settings("Manicorp", "OblivionVoiceFrenchiser", this)
-	, correspondingRaces{
-		{ "high_elf", { "haut_elfe", "imperial", "shéogorath" } },
-		{ "wood_elf", { "haut_elfe", "imperial", "shéogorath" } },
-		{ "redguard", { "rougegarde", "imperial", "haut elfe", "nordique", "shéogorath" } }, //je sais pas encore nordique ou haut elfe
-		{ "dark_elf", { "haut_elfe", "imperial", "shéogorath" } },
-		{ "argonian", { "argonien", "haut_elfe", "shéogorath" } },
-		{ "khajiit", { "argonien", "haut_elfe", "shéogorath" } },
-		{ "nord", { "nordique", "rougegarde", "imperial", "haut elfe", "shéogorath" } }, //je sais pas encore rougegarde ou impérial
-		{ "orc", { "nordique", "rougegarde", "imperial", "shéogorath" } }, //je sais pas encore rougegarde ou impérial
-		{ "breton", { "imperial", "haut_elfe", "nordique", "shéogorath" } },
-		{ "imperial", { "imperial", "haut_elfe", "rougegarde", "nordique", "shéogorath" } },
-		{ "dark_seducer", { "vil_séducteur", "shéogorath" } },
-		{ "golden_saint", { "saint_doré", "shéogorath" } },
-		{ "sheogorath", { "shéogorath", "shéogorath" } },
-		{ "dremora", { "drémora", "shéogorath" } }
-	}
-	, subFolders{ "altvoice", "beggar" }
-	, shittyReplace{
-		{"_alt01", ""},
-		{"_elf_f_0300", "_1"},
-	}
 {
 	ui->setupUi(this);
 
@@ -42,295 +23,203 @@ MainWindow::MainWindow(QWidget* parent)
 	ui->s3OutputFolderLineEdit->blockSignals(true);
 	ui->s3OutputFolderLineEdit->setText(settings.value("s3OutputFolder", QDir::homePath()).toString());
 	ui->s3OutputFolderLineEdit->blockSignals(false);
-
-	ui->progressBar->setVisible(false);
+	ui->s3SyncCheckBox->setChecked(settings.value("s3Sync", false).toBool());
+	ui->s3FuzzyCheckBox->setChecked(settings.value("s3Fuzzy", false).toBool());
+	ui->s3SkipCodecMismatchCheckBox->setChecked(settings.value("s3SkipCodecMismatch", false).toBool());
+	ui->s3PackCheckBox->setChecked(settings.value("s3Pack", false).toBool());
+	ui->s3WatchCheckBox->blockSignals(true);
+	ui->s3WatchCheckBox->setChecked(settings.value("s3Watch", false).toBool());
+	ui->s3WatchCheckBox->blockSignals(false);
+	ui->s3StrategyComboBox->setCurrentIndex(settings.value("s3Strategy", FileMaterializer::Auto).toInt());
+	ui->s3CopyThreadsSpinBox->setValue(settings.value("s3CopyThreads", 0).toInt());
+
+	showProgress(false);
 
 	connect(&s1ProcessFolderFutureWatcher, &QFutureWatcher<QList<WemFile>>::finished, this, &MainWindow::s1ProcessFinished);
-	connect(&s1ProcessFilesFutureWatcher, &QFutureWatcher<WemFile>::progressValueChanged, ui->progressBar, &QProgressBar::setValue);
-	connect(&s2ProcessVoiceFolderFutureWatcher, &QFutureWatcher<QStringList>::finished, this, &MainWindow::s2ProcessVoiceFolderFinished);
-	connect(&s2ProcessVoiceFilesFutureWatcher, &QFutureWatcher<QString>::finished, this, &MainWindow::s2ProcessVoiceFilesFinished);
-	connect(&s3ProcessVoiceFutureWatcher, &QFutureWatcher<WemFile>::progressValueChanged, ui->progressBar, &QProgressBar::setValue);
+	connect(&s2ProcessVoiceFolderFutureWatcher, &QFutureWatcher<QList<VoiceFile>>::finished, this, &MainWindow::s2ProcessVoiceFolderFinished);
 	connect(&s3ProcessVoiceFutureWatcher, &QFutureWatcher<MatchingFile>::finished, this, &MainWindow::s3ProcessVoicesFinished);
-	connect(&s3ProcessReplaceVoiceFutureWatcher, &QFutureWatcher<void>::progressValueChanged, ui->progressBar, &QProgressBar::setValue);
+	connect(&s3PlanOutputsFutureWatcher, &QFutureWatcher<void>::finished, this, &MainWindow::s3PlanOutputsFinished);
 	connect(&s3ProcessReplaceVoiceFutureWatcher, &QFutureWatcher<void>::finished, this, &MainWindow::s3ProcessReplaceVoicesFinished);
+	connect(&applyPlanFutureWatcher, &QFutureWatcher<bool>::finished, this, &MainWindow::applyPlanLoaded);
+	connect(&watchFutureWatcher, &QFutureWatcher<Frenchiser::WatchUpdate>::finished, this, &MainWindow::watchUpdated);
+	connect(&voiceWatcher, &VoiceWatcher::foldersChanged, this, &MainWindow::voiceFoldersChanged);
+	progressTimer.setInterval(50);
+	connect(&progressTimer, &QTimer::timeout, this, &MainWindow::updateProgress);
 
 	QDir::current().mkdir("logs");
+
+	frenchiser.loadCaches(Frenchiser::defaultCacheFolder(settings));
 }
 
 MainWindow::~MainWindow()
 {
+	frenchiser.cancel();
+	voiceWatcher.stop();
 	s1ProcessFolderFuture.cancel();
 	s1ProcessFolderFutureWatcher.cancel();
-	s1ProcessFilesFuture.cancel();
-	s1ProcessFilesFutureWatcher.cancel();
 	s2ProcessVoiceFolderFuture.cancel();
 	s2ProcessVoiceFolderFutureWatcher.cancel();
-	s2ProcessVoiceFilesFuture.cancel();
-	s2ProcessVoiceFilesFutureWatcher.cancel();
 	s3ProcessVoiceFuture.cancel();
 	s3ProcessVoiceFutureWatcher.cancel();
+	s3PlanOutputsFuture.cancel();
+	s3PlanOutputsFutureWatcher.cancel();
 	s3ProcessReplaceVoiceFuture.cancel();
 	s3ProcessReplaceVoiceFutureWatcher.cancel();
+	applyPlanFutureWatcher.cancel();
+	// Toutes ces tâches travaillent sur frenchiser, détruit juste après : on attend qu'elles
+	// aient vu l'annulation
+	s1ProcessFolderFuture.waitForFinished();
+	s2ProcessVoiceFolderFuture.waitForFinished();
+	s3ProcessVoiceFuture.waitForFinished();
+	s3PlanOutputsFuture.waitForFinished();
+	s3ProcessReplaceVoiceFuture.waitForFinished();
+	applyPlanFuture.waitForFinished();
+	watchFuture.waitForFinished();
+	waitForReports();
 
 	delete ui;
 }
 
-QStringList MainWindow::getFilesInFolder(const QString& folderPath, const QStringList& fileSuffixes)
+QList<WemFile> MainWindow::s1ProcessFolder(const QString& folderPath)
 {
-	QDirIterator it(folderPath, fileSuffixes, QDir::Files, QDirIterator::Subdirectories);
-	QStringList files;
-	while (it.hasNext())
+	QList<WemFile> wemFiles = frenchiser.s1ProcessBankFolder(folderPath);
+	if (frenchiser.isCanceled())
 	{
-		QString file = it.next();
-		files << file;
-		if (s1ProcessFolderFuture.isCanceled())
-		{
-			return QStringList();
-		}
+		return QList<WemFile>();
 	}
-	return files;
+	wemFiles.append(frenchiser.s1ProcessFolder(folderPath));
+	return wemFiles;
 }
 
-QString MainWindow::getLineId(const QString& filePath) const
+void MainWindow::on_s1InputFolderPushButton_clicked()
 {
-	QString part = QFileInfo(filePath).baseName();
-	QStringList parts = part.split("_");
-	for (int i = parts.size() - 1; i >= 0; i--)
-	{
-		if (parts[i].size() == 8)
-		{
-			return parts[i];
-		}
-	}
-	return QString();
-}
+	QString dir = QFileDialog::getExistingDirectory(this, tr("Ouvrir le dossier"),
+		settings.value("s1InputFolder", QDir::homePath()).toString(),
+		QFileDialog::ShowDirsOnly
+		| QFileDialog::DontResolveSymlinks);
 
-QString MainWindow::getFullLineId(const QString& filePath) const
-{
-	QString part = QFileInfo(filePath).fileName();
-	QStringList parts = part.split("_");
-	bool processId = false;
-	QString fullLineId;
-	for (const QString& part : parts)
+	if (!dir.isEmpty())
 	{
-		if (processId)
-		{
-			if (part.contains("."))
-			{
-				break;
-			}
-			fullLineId += part + "_";
-		}
-
-		if (part.size() == 1)
-		{
-			processId = true;
-		}
+		settings.setValue("s1InputFolder", dir);
+		ui->s1InputFolderLineEdit->setText(dir);
 	}
-
-	fullLineId.removeLast();
-	return fullLineId;
 }
 
-QChar MainWindow::getSex(const QString& filePath) const
+bool MainWindow::checkFolder(const QString& folder, bool output)
 {
-	const QString fileName = QFileInfo(filePath).baseName();
-	const QStringList parts = fileName.split("_");
-	for (const QString& part : parts)
+	if (folder.isEmpty())
 	{
-		if (part.size() == 1)
-		{
-			if (part == "m" || part == "f")
-			{
-				return part[0];
-			}
-		}
+		QMessageBox::warning(this, tr("Erreur"), output ? tr("Veuillez sélectionner un dossier de sortie.") : tr("Veuillez sélectionner un dossier d'entrée."));
+		return false;
 	}
-	return QChar();
-}
-
-QList<WemFile> MainWindow::s1ProcessFolder(const QString& folderPath)
-{
-	QStringList files = getFilesInFolder(folderPath, QStringList() << "*.txtp");
-	if (s1ProcessFolderFuture.isCanceled())
+	QDir dir(folder);
+	if (!dir.exists())
 	{
-		return QList<WemFile>();
+		QMessageBox::warning(this, tr("Erreur"), output ? tr("Le dossier de sortie n'existe pas.") : tr("Le dossier d'entrée n'existe pas."));
+		return false;
 	}
-	ui->progressBar->setMaximum(files.size());
-	s1ProcessFilesFuture = QtConcurrent::mapped(files,
-		[this](const QString& filePath)
-		{
-			return this->s1ProcessFile(filePath);
-		}
-	);
-	s1ProcessFilesFutureWatcher.setFuture(s1ProcessFilesFuture);
-
-	return s1ProcessFilesFuture.results();
+	return true;
 }
 
-WemFile MainWindow::s1ProcessFile(const QString& filePath)
+void MainWindow::waitForReports()
 {
-	WemFile result;
-	QFile file(filePath);
-	if (file.open(QFile::ReadOnly))
+	// Les rapports lisent les listes du moteur : on les laisse finir avant qu'une étape les remplace
+	for (QFuture<void>& reportFuture : reportFutures)
 	{
-		QString fileContent = file.readAll();
-		file.close();
-		QStringList codec = fileContent.split("ulPluginID:");
-		codec = codec[1].split("[");
-		codec = codec[1].split("]");
-		QString fileName = QFileInfo(filePath).baseName();
-		QStringList wemData = fileContent.split(".wem");
-		QString wemFileName = wemData[0].split("/").last();
-		result.filePath = filePath;
-		result.id = wemFileName.toUInt();
-		result.codec = codec[0];
+		reportFuture.waitForFinished();
 	}
-	return result;
-}
-
-QStringList MainWindow::s2ProcessVoiceFolder(const QString& folderPath)
-{
-	return getFilesInFolder(folderPath, QStringList() << "*.mp3" << "*.wem");
-}
-
-VoiceFile MainWindow::s2ProcessVoiceFile(const QString& filePath)
-{
-	VoiceFile result;
-	result.filePath = filePath;
-	QString fileName = filePath.split(".esp/").last();
-	fileName = fileName.split(".esm/").last();
-	QStringList elements = fileName.split("/");
-	fileName.replace("/", "_");
-	fileName.replace(" ", "_");
-	fileName = "Play_" + fileName;
-	result.correspondingName = fileName.split("." + QFileInfo(fileName).suffix()).first();
-	return result;
+	reportFutures.clear();
 }
 
-MatchingFile MainWindow::s3ProcessVoice(const WemFile& wemFile)
+void MainWindow::on_runAllPushButton_clicked()
 {
-	MatchingFile result;
-	result.wemFile = &wemFile;
-	QString outputFolder = ui->s3OutputFolderLineEdit->text();
-
-	QString currentFilePath = wemFile.filePath;
-	currentFilePath.replace("v.txtp", ".txtp");
-	QString baseName = QFileInfo(currentFilePath).baseName();
-
-	if (voiceFileByBaseNames.contains(baseName))
+	if (isBusy() || voiceWatcher.isActive())
 	{
-		result.found = true;
-		result.voiceFile = voiceFileByBaseNames[baseName];
-		return result;
+		return;
 	}
-	else
+	if (!checkFolder(ui->s1InputFolderLineEdit->text(), false)
+		|| !checkFolder(ui->s2InputFolderLineEdit->text(), false)
+		|| !checkFolder(ui->s3OutputFolderLineEdit->text(), true))
 	{
-		baseName.replace("_alt01", "");
-		baseName.replace("_elf_f_0300", "_1");
-		for (const QString& subFolder : subFolders)
-		{
-			baseName.replace("_" + subFolder + "_", "_");
-		}
-		for (const QString& correspondingRace : correspondingRaces.keys())
-		{
-			if (baseName.contains("_" + correspondingRace + "_"))
-			{
-				for (const QString& transCorrespondingRace : correspondingRaces[correspondingRace])
-				{
-					QString transName = baseName;
-					transName.replace("_" + correspondingRace + "_", "_" + transCorrespondingRace + "_");
-					if (voiceFileByBaseNames.contains(transName))
-					{
-						result.found = true;
-						result.voiceFile = voiceFileByBaseNames[transName];
-						return result;
-					}
-				}
-			}
-		}
-
-		//Sauvage !!
-		//QStringList fileNameParts = baseName.split("_");
-		//baseName = fileNameParts.last();
-		//for (int i = fileNameParts.count() - 2 ; i >= 0 ; i--)
-		//{
-		//	if (fileNameParts[i] == "m" || fileNameParts[i] == "f")
-		//	{
-		//		break;
-		//	}
-		//	baseName = fileNameParts[i] + "_" + baseName;
-		//}
-		//for (const QString& voiceFileByBaseName : voiceFileByBaseNames.keys())
-		//{
-		//	if (voiceFileByBaseName.contains(baseName))
-		//	{
-		//		result.found = true;
-		//		result.voiceFile = voiceFileByBaseNames[voiceFileByBaseName];
-		//		return result;
-		//	}
-		//}
+		return;
 	}
 
-	return result;
-}
+	// Les étapes 1 et 2 parcourent des arborescences distinctes : on les lance ensemble,
+	// l'étape 3 part dès que les deux index sont prêts
+	runAll = true;
+	runAllPendingStages = 2;
+	setScanEnabled(false);
+	ui->s3ReplaceVoicesGroupBox->setEnabled(false);
 
-void MainWindow::replaceVoice(const MatchingFile& matchingFile, const QString& outputFolder)
-{
-	QFile::copy(matchingFile.voiceFile->filePath, outputFolder + "/" + QString::number(matchingFile.wemFile->id) + ".wem");
+	// Les deux parcours comptent ensemble leurs fichiers
+	frenchiser.getProgress().reset();
+	s1Start(ui->s1InputFolderLineEdit->text());
+	s2Start(ui->s2InputFolderLineEdit->text());
 }
 
-void MainWindow::on_s1InputFolderPushButton_clicked()
+void MainWindow::runAllStageFinished()
 {
-	QString dir = QFileDialog::getExistingDirectory(this, tr("Ouvrir le dossier"),
-		settings.value("s1InputFolder", QDir::homePath()).toString(),
-		QFileDialog::ShowDirsOnly
-		| QFileDialog::DontResolveSymlinks);
-
-	if (!dir.isEmpty())
+	runAllPendingStages--;
+	if (runAllPendingStages == 0)
 	{
-		settings.setValue("s1InputFolder", dir);
-		ui->s1InputFolderLineEdit->setText(dir);
+		s3Start(ui->s3OutputFolderLineEdit->text());
 	}
 }
 
 void MainWindow::on_s1ProcessPushButton_clicked()
 {
-	QString inputFolder = ui->s1InputFolderLineEdit->text();
-	if (inputFolder.isEmpty())
+	// Même si le bouton est resté actif : l'étape 3 lit la progression et les réglages figés,
+	// que ce départ remettrait à zéro sous ses threads
+	if (isStage3Running())
 	{
-		QMessageBox::warning(this, tr("Erreur"), tr("Veuillez sélectionner un dossier d'entrée."));
 		return;
 	}
-	QDir dir(inputFolder);
-	if (!dir.exists())
+	QString inputFolder = ui->s1InputFolderLineEdit->text();
+	if (!checkFolder(inputFolder, false))
 	{
-		QMessageBox::warning(this, tr("Erreur"), tr("Le dossier d'entrée n'existe pas."));
 		return;
 	}
 
-	settings.setValue("s1InputFolder", inputFolder);
 	ui->s1GroupBox->setEnabled(false);
+	frenchiser.getProgress().reset();
+	s1Start(inputFolder);
+}
 
-	ui->progressBar->setRange(0, 0);
-	ui->progressBar->setVisible(true);
+void MainWindow::s1Start(const QString& inputFolder)
+{
+	waitForReports();
+	stopWatchForScan();
+	settings.setValue("s1InputFolder", inputFolder);
 
-	s1ProcessFolderFuture = QtConcurrent::run(&MainWindow::s1ProcessFolder, this, ui->s1InputFolderLineEdit->text());
+	showProgress(true);
+
+	s1ProcessFolderFuture = QtConcurrent::run(&MainWindow::s1ProcessFolder, this, inputFolder);
 	s1ProcessFolderFutureWatcher.setFuture(s1ProcessFolderFuture);
 }
 
 void MainWindow::s1ProcessFinished()
 {
-	ui->s1GroupBox->setEnabled(true);
-	ui->progressBar->setVisible(false);
-	ui->s2GroupBox->setEnabled(true);
-
-	wemFiles = s1ProcessFolderFuture.result();
+	ui->s1GroupBox->setEnabled(!runAll);
+	showProgress(runAll);
+	ui->s2GroupBox->setEnabled(!runAll);
+
+	// Le résultat est repris tel quel, sans copie
+	frenchiser.setWemFiles(s1ProcessFolderFuture.takeResult());
+	reportFutures.append(QtConcurrent::run(
+		[this]()
+		{
+			frenchiser.saveTxtpCache();
+			frenchiser.writeTxtpErrorsLog();
+		}
+	));
+	if (!frenchiser.getInvalidWemFiles().isEmpty())
+	{
+		ui->statusbar->showMessage(tr("Fichiers txtp invalides : ") + QString::number(frenchiser.getInvalidWemFiles().size()));
+	}
 
-	for (WemFile& wemFile : wemFiles)
+	if (runAll)
 	{
-		QString baseName = QFileInfo(wemFile.filePath).baseName();
-		wemByBaseNames[baseName] = &wemFile;
+		runAllStageFinished();
 	}
 }
 
@@ -349,80 +238,52 @@ void MainWindow::on_s2InputFolderPushButton_clicked()
 
 void MainWindow::on_s2ProcessPushButton_clicked()
 {
-	QString inputFolder = ui->s2InputFolderLineEdit->text();
-	if (inputFolder.isEmpty())
+	if (isStage3Running())
 	{
-		QMessageBox::warning(this, tr("Erreur"), tr("Veuillez sélectionner un dossier d'entrée."));
 		return;
 	}
-	QDir dir(inputFolder);
-	if (!dir.exists())
+	QString inputFolder = ui->s2InputFolderLineEdit->text();
+	if (!checkFolder(inputFolder, false))
 	{
-		QMessageBox::warning(this, tr("Erreur"), tr("Le dossier d'entrée n'existe pas."));
 		return;
 	}
 
-	settings.setValue("s2InputFolder", inputFolder);
 	ui->s2GroupBox->setEnabled(false);
-	ui->progressBar->setRange(0, 0);
-	ui->progressBar->setVisible(true);
-	voiceFiles.clear();
-	s2ProcessVoiceFolderFuture = QtConcurrent::run(&MainWindow::s2ProcessVoiceFolder, this, ui->s2InputFolderLineEdit->text());
+	frenchiser.getProgress().reset();
+	s2Start(inputFolder);
+}
+
+void MainWindow::s2Start(const QString& inputFolder)
+{
+	waitForReports();
+	stopWatchForScan();
+	settings.setValue("s2InputFolder", inputFolder);
+	showProgress(true);
+	s2ProcessVoiceFolderFuture = QtConcurrent::run(&Frenchiser::s2ProcessVoiceFolder, &frenchiser, inputFolder);
 	s2ProcessVoiceFolderFutureWatcher.setFuture(s2ProcessVoiceFolderFuture);
 }
 
 void MainWindow::s2ProcessVoiceFolderFinished()
 {
-	QStringList voiceFilePaths = s2ProcessVoiceFolderFuture.result();
-	ui->progressBar->setMaximum(voiceFilePaths.size());
+	ui->s2GroupBox->setEnabled(!runAll);
+	showProgress(runAll);
 
-	s2ProcessVoiceFilesFuture = QtConcurrent::mapped(voiceFilePaths,
-		[this](const QString& filePath)
+	frenchiser.setVoiceFiles(s2ProcessVoiceFolderFuture.takeResult());
+	reportFutures.append(QtConcurrent::run(
+		[this, inputFolder = ui->s2InputFolderLineEdit->text()]()
 		{
-			return this->s2ProcessVoiceFile(filePath);
+			frenchiser.writeFrenchFilesLog(inputFolder);
+			frenchiser.saveVoiceCache();
 		}
-	);
-	s2ProcessVoiceFilesFutureWatcher.setFuture(s2ProcessVoiceFilesFuture);
+	));
 
-	QFile frenchFilesLog("logs/frenchFiles.log");
-	if (frenchFilesLog.open(QIODevice::WriteOnly | QIODevice::Text))
-	{
-		QTextStream out(&frenchFilesLog);
-		for (const QString& filePath : voiceFilePaths)
-		{
-			QString shortFilePath = filePath;
-			shortFilePath.replace(ui->s2InputFolderLineEdit->text() + "/", "");
-			out << QFileInfo(filePath).fileName() << "\t\t\t" << shortFilePath << Qt::endl;
-		}
-		frenchFilesLog.close();
-	}
-}
-
-void MainWindow::s2ProcessVoiceFilesFinished()
-{
-	ui->s2GroupBox->setEnabled(true);
-	ui->progressBar->setVisible(false);
-
-	voiceFiles = s2ProcessVoiceFilesFuture.results();
-
-	QStringList voiceFileList;
-	for (VoiceFile& voiceFile : voiceFiles)
-	{
-		voiceFileList << voiceFile.correspondingName;
-		voiceFileByBaseNames[voiceFile.correspondingName] = &voiceFile;
-	}
-
-	ui->s3ReplaceVoicesGroupBox->setEnabled(true);
+	ui->s3ReplaceVoicesGroupBox->setEnabled(!runAll);
 
-	ui->statusbar->showMessage(tr("Fichiers trouvés : ") + QString::number(voiceFiles.size()));
+	ui->statusbar->showMessage(tr("Fichiers trouvés : ") + QString::number(frenchiser.getVoiceFiles().size()));
 
-	for (VoiceFile& voiceFile : voiceFiles)
+	if (runAll)
 	{
-		const QString& lineId = getFullLineId(voiceFile.filePath);
-		if (!lineId.isEmpty())
-		{
-			voiceFileByLineIds[lineId].append(&voiceFile);
-		}
+		runAllStageFinished();
 	}
 }
 
@@ -441,138 +302,439 @@ void MainWindow::on_s3OutputFolderPushButton_clicked()
 
 void MainWindow::on_s3ReplaceVoicesPushButton_clicked()
 {
-	QString outputFolder = ui->s3OutputFolderLineEdit->text();
-	if (outputFolder.isEmpty())
+	if (isBusy())
 	{
-		QMessageBox::warning(this, tr("Erreur"), tr("Veuillez sélectionner un dossier de sortie."));
 		return;
 	}
-	QDir dir(outputFolder);
-	if (!dir.exists())
+	QString outputFolder = ui->s3OutputFolderLineEdit->text();
+	if (!checkFolder(outputFolder, true))
 	{
-		QMessageBox::warning(this, tr("Erreur"), tr("Le dossier de sortie n'existe pas."));
 		return;
 	}
 
-	settings.setValue("s3OutputFolder", outputFolder);
 	ui->s3ReplaceVoicesGroupBox->setEnabled(false);
-	ui->progressBar->setMaximum(wemFiles.size());
-	ui->progressBar->setVisible(true);
+	s3Start(outputFolder);
+}
+
+void MainWindow::on_s3SavePlanPushButton_clicked()
+{
+	if (isBusy())
+	{
+		return;
+	}
+	const QString planPath = QFileDialog::getSaveFileName(this, tr("Enregistrer le plan"),
+		settings.value("planFile", QDir::homePath() + "/plan.tsv").toString(),
+		tr("Plans (*.tsv)"));
+	if (planPath.isEmpty())
+	{
+		return;
+	}
+	settings.setValue("planFile", planPath);
 
-	matchingFiles.clear();
+	this->planPath = planPath;
+	ui->s3ReplaceVoicesGroupBox->setEnabled(false);
+	s3Start(ui->s3OutputFolderLineEdit->text());
+}
 
-	s3ProcessVoiceFuture = QtConcurrent::mapped(wemFiles,
+void MainWindow::s3Start(const QString& outputFolder)
+{
+	waitForReports();
+	// Correspondance, plan et copie suivent des pointeurs dans les listes des étapes 1 et 2 :
+	// aucune analyse ne doit les remplacer avant la fin (ni pendant la surveillance qui suit)
+	setScanEnabled(false);
+	s3Snapshot(outputFolder);
+	const QList<WemFile>& wemFiles = frenchiser.getWemFiles();
+	frenchiser.getProgress().reset(wemFiles.size());
+	showProgress(true);
+
+	frenchiser.getRunReport().begin(RunReport::S3Match);
+	s3ProcessVoiceFuture = QtConcurrent::mapped(wemFiles.constBegin(), wemFiles.constEnd(),
 		[this](const WemFile& wemFile)
 		{
-			return this->s3ProcessVoice(wemFile);
+			return frenchiser.s3ProcessVoice(wemFile);
 		}
 	);
 	s3ProcessVoiceFutureWatcher.setFuture(s3ProcessVoiceFuture);
 }
 
+void MainWindow::s3Snapshot(const QString& outputFolder)
+{
+	settings.setValue("s3OutputFolder", outputFolder);
+	settings.setValue("s3Sync", ui->s3SyncCheckBox->isChecked());
+	settings.setValue("s3Strategy", ui->s3StrategyComboBox->currentIndex());
+	settings.setValue("s3CopyThreads", ui->s3CopyThreadsSpinBox->value());
+	settings.setValue("s3Fuzzy", ui->s3FuzzyCheckBox->isChecked());
+	settings.setValue("s3SkipCodecMismatch", ui->s3SkipCodecMismatchCheckBox->isChecked());
+	settings.setValue("s3Pack", ui->s3PackCheckBox->isChecked());
+	settings.setValue("s3Watch", ui->s3WatchCheckBox->isChecked());
+
+	Frenchiser::Options options;
+	options.fuzzyMatching = ui->s3FuzzyCheckBox->isChecked();
+	options.skipCodecMismatches = ui->s3SkipCodecMismatchCheckBox->isChecked();
+	options.outputStrategy = FileMaterializer::Strategy(ui->s3StrategyComboBox->currentIndex());
+	options.copyThreads = ui->s3CopyThreadsSpinBox->value();
+	options.packedOutput = ui->s3PackCheckBox->isChecked();
+	frenchiser.setOptions(options);
+	s3OutputFolder = outputFolder;
+	s3Sync = ui->s3SyncCheckBox->isChecked();
+}
+
 void MainWindow::s3ProcessVoicesFinished()
 {
-	matchingFiles = s3ProcessVoiceFuture.results();
-	ui->progressBar->setMaximum(matchingFiles.size());
+	frenchiser.setMatchingFiles(s3ProcessVoiceFuture.results());
+	frenchiser.getRunReport().end(RunReport::S3Match);
+	frenchiser.getProgress().reset();
 
-	s3ProcessReplaceVoiceFuture = QtConcurrent::map(matchingFiles,
-		[this](const MatchingFile& matchingFile)
-		{
-			if (matchingFile.found)
-			{
-				this->replaceVoice(matchingFile, ui->s3OutputFolderLineEdit->text());
-			}
-		}
-	);
-	s3ProcessReplaceVoiceFutureWatcher.setFuture(s3ProcessReplaceVoiceFuture);
+	s3PlanOutputsFuture = QtConcurrent::run(&Frenchiser::planOutputs, &frenchiser);
+	s3PlanOutputsFutureWatcher.setFuture(s3PlanOutputsFuture);
 
-	QFile foundFilesLog("logs/foundFiles.log");
-	if (foundFilesLog.open(QFile::WriteOnly | QFile::Text))
+	// En parallèle de la copie, qui ne fait que lire les mêmes listes
+	reportFutures.append(QtConcurrent::run(&Frenchiser::writeMatchingLogs, &frenchiser));
+}
+
+void MainWindow::s3PlanOutputsFinished()
+{
+	if (!planPath.isEmpty())
 	{
-		QTextStream out(&foundFilesLog);
-		for (const MatchingFile& matchingFile : matchingFiles)
+		// Sources enregistrées relativement au dossier analysé à l'étape 2
+		const bool written = frenchiser.writePlan(planPath, settings.value("s2InputFolder").toString());
+		reportFutures.append(QtConcurrent::run(&Frenchiser::writeRunReport, &frenchiser));
+		ui->s3ReplaceVoicesGroupBox->setEnabled(true);
+		setScanEnabled(true);
+		showProgress(false);
+		if (written)
 		{
-			if (matchingFile.found)
+			qsizetype outputCount = 0;
+			for (const OutputGroup& outputGroup : frenchiser.getOutputGroups())
 			{
-				out << QFileInfo(matchingFile.wemFile->filePath).fileName() << "\t" << QFileInfo(matchingFile.voiceFile->filePath).fileName() << "\t" << matchingFile.wemFile->id << Qt::endl;
+				outputCount += outputGroup.matchingFiles.size();
 			}
+			QMessageBox::information(this, tr("Terminé"), tr("Plan enregistré : %1 sorties.").arg(outputCount));
+		}
+		else
+		{
+			QMessageBox::warning(this, tr("Erreur"), tr("Impossible d'écrire le plan ") + planPath);
 		}
-		foundFilesLog.close();
+		planPath.clear();
+		return;
 	}
 
-	QFile missingFilesLog("logs/missingFiles.log");
-	if (missingFilesLog.open(QFile::WriteOnly | QFile::Text))
+	const QList<OutputGroup>& outputGroups = frenchiser.getOutputGroups();
+	qsizetype outputCount = 0;
+	for (const OutputGroup& outputGroup : outputGroups)
 	{
-		QTextStream out(&missingFilesLog);
-		for (const MatchingFile& matchingFile : matchingFiles)
-		{
-			if (!matchingFile.found)
+		outputCount += outputGroup.matchingFiles.size();
+	}
+	frenchiser.getProgress().reset(outputCount);
+
+	const QString outputFolder = s3OutputFolder;
+	// Copie précédente de ce même plan interrompue (fenêtre fermée, plantage) : ce qu'elle a écrit peut être gardé
+	bool resume = false;
+	const qsizetype resumableCount = frenchiser.getOptions().packedOutput ? 0 : frenchiser.getResumableCount(outputFolder);
+	if (resumableCount > 0)
+	{
+		resume = QMessageBox::question(this, tr("Copie interrompue"),
+			tr("Une copie vers ce dossier a été interrompue après %1 sorties sur %2.\nLa reprendre là où elle s'est arrêtée ?").arg(resumableCount).arg(outputCount))
+			== QMessageBox::Yes;
+	}
+
+	frenchiser.resetReplaceCounts();
+	frenchiser.getRunReport().begin(RunReport::S3Copy);
+	if (frenchiser.getOptions().packedOutput)
+	{
+		// Un seul fichier écrit par un seul thread, alimenté par les lectures du pool
+		s3ProcessReplaceVoiceFuture = QtConcurrent::run(
+			[this, outputFolder]()
 			{
-				out << QFileInfo(matchingFile.wemFile->filePath).fileName() << "\t[" << matchingFile.wemFile->id << "]" << Qt::endl;
+				frenchiser.writePackage(Frenchiser::packagePath(outputFolder));
 			}
-		}
-		missingFilesLog.close();
+		);
+	}
+	else
+	{
+		// Pool dédié du CopyScheduler, dans l'ordre des sources sur le disque
+		s3ProcessReplaceVoiceFuture = QtConcurrent::run(&Frenchiser::replaceVoices, &frenchiser, outputFolder, resume);
 	}
+	s3ProcessReplaceVoiceFutureWatcher.setFuture(s3ProcessReplaceVoiceFuture);
+}
+
+void MainWindow::s3ProcessReplaceVoicesFinished()
+{
+	frenchiser.getRunReport().end(RunReport::S3Copy);
+	reportFutures.append(QtConcurrent::run(&Frenchiser::writeRunReport, &frenchiser));
 
-	QFile missingFilesIdFoundLog("logs/missingFilesIdFound.log");
-	if (missingFilesIdFoundLog.open(QFile::WriteOnly | QFile::Text))
+	int removed = 0;
+	if (s3Sync)
 	{
-		QTextStream out(&missingFilesIdFoundLog);
-		for (const MatchingFile& matchingFile : matchingFiles)
+		removed = frenchiser.removeStaleOutputs(s3OutputFolder);
+	}
+
+	// Un plan appliqué peut venir d'un autre dossier VF : seule une passe complète est surveillée
+	watchVoiceFolder = applyingPlan ? QString() : settings.value("s2InputFolder").toString();
+	startWatch();
+
+	runAll = false;
+	applyingPlan = false;
+	// Les analyses restent bloquées tant que la surveillance suit ces listes
+	setScanEnabled(!voiceWatcher.isActive());
+	ui->s3ReplaceVoicesGroupBox->setEnabled(true);
+	showProgress(false);
+
+	const FileMaterializer& materializer = frenchiser.getMaterializer();
+	QString summary = tr("Copiés : %1\nMis à jour : %2\nInchangés : %3\nSupprimés : %4\nÉchecs : %5\n\nLiens : %6, clones : %7, copies noyau : %8, copies : %9")
+		.arg(frenchiser.getReplaceCount(Frenchiser::Copied))
+		.arg(frenchiser.getReplaceCount(Frenchiser::Updated))
+		.arg(frenchiser.getReplaceCount(Frenchiser::Unchanged))
+		.arg(removed)
+		.arg(frenchiser.getReplaceCount(Frenchiser::ReplaceFailed))
+		.arg(materializer.getCount(FileMaterializer::Hardlink))
+		.arg(materializer.getCount(FileMaterializer::Reflink))
+		.arg(materializer.getCount(FileMaterializer::KernelCopy))
+		.arg(materializer.getCount(FileMaterializer::Copy));
+	if (frenchiser.getResumedCount() > 0)
+	{
+		summary += "\n" + tr("Déjà écrits avant l'interruption : %1").arg(frenchiser.getResumedCount());
+	}
+	const CopyScheduler::Stats& copyStats = frenchiser.getCopyStats();
+	if (copyStats.items > 0)
+	{
+		summary += "\n" + tr("Copies simultanées : %1 à %2, meilleur débit %3 Mo/s avec %4")
+			.arg(copyStats.minThreads)
+			.arg(copyStats.maxThreads)
+			.arg(copyStats.bestMbPerSecond, 0, 'f', 1)
+			.arg(copyStats.bestThreads);
+	}
+	summary += "\n" + tr("Doublons dédupliqués : %1 (%2 Mo économisés)")
+		.arg(frenchiser.getDedupFileCount())
+		.arg(frenchiser.getDedupByteCount() / (1024 * 1024));
+	summary += "\n" + tr("Formats incompatibles : %1 (%2)")
+		.arg(frenchiser.getCodecMismatchCount())
+		.arg(frenchiser.getOptions().skipCodecMismatches ? tr("ignorés") : tr("copiés quand même, voir logs/codecMismatches.log"));
+	if (!frenchiser.getPackageError().isEmpty())
+	{
+		summary += "\n" + tr("Package non écrit : %1").arg(frenchiser.getPackageError());
+	}
+	if (frenchiser.getReplaceCount(Frenchiser::ReplaceFailed) > 0)
+	{
+		QMessageBox::warning(this, tr("Terminé"), tr("Certaines voix n'ont pas pu être copiées.") + "\n\n" + summary);
+	}
+	else
+	{
+		QMessageBox::information(this, tr("Terminé"), tr("Les voix ont été remplacées avec succès.") + "\n\n" + summary);
+	}
+}
+
+void MainWindow::on_applyPlanPushButton_clicked()
+{
+	if (isBusy() || voiceWatcher.isActive())
+	{
+		return;
+	}
+	const QString outputFolder = ui->s3OutputFolderLineEdit->text();
+	if (!checkFolder(outputFolder, true))
+	{
+		return;
+	}
+	const QString planPath = QFileDialog::getOpenFileName(this, tr("Appliquer un plan"),
+		settings.value("planFile", QDir::homePath()).toString(),
+		tr("Plans (*.tsv)"));
+	if (planPath.isEmpty())
+	{
+		return;
+	}
+	settings.setValue("planFile", planPath);
+
+	// Le plan remplace les listes des étapes 1 à 3 : plus rien ne doit les lire
+	waitForReports();
+	s3Snapshot(outputFolder);
+	applyingPlan = true;
+	setScanEnabled(false);
+	ui->s3ReplaceVoicesGroupBox->setEnabled(false);
+	frenchiser.getProgress().reset();
+	showProgress(true);
+
+	applyPlanFuture = QtConcurrent::run(
+		[this, planPath]()
 		{
-			if (!matchingFile.found)
+			const bool loaded = frenchiser.loadPlan(planPath, QString());
+			if (loaded)
 			{
-				QString lineId = getFullLineId(matchingFile.wemFile->filePath);
-				if (voiceFileByLineIds.contains(lineId))
-				{
-					bool sameSexFound = false;
-					for (const VoiceFile* voiceFile : voiceFileByLineIds[lineId])
-					{
-						if (getSex(voiceFile->correspondingName) == getSex(matchingFile.wemFile->filePath))
-						{
-							sameSexFound = true;
-							break;
-						}
-					}
-
-					if (sameSexFound)
-					{
-						out << lineId << "\t" << QFileInfo(matchingFile.wemFile->filePath).fileName() << "\t[" << matchingFile.wemFile->id << "]" << Qt::endl;
-					}
-				}
+				frenchiser.writeStalePlanLog();
 			}
+			return loaded;
 		}
-		missingFilesIdFoundLog.close();
+	);
+	applyPlanFutureWatcher.setFuture(applyPlanFuture);
+}
+
+void MainWindow::applyPlanLoaded()
+{
+	if (!applyPlanFuture.result())
+	{
+		applyingPlan = false;
+		setScanEnabled(true);
+		showProgress(false);
+		QMessageBox::warning(this, tr("Erreur"), tr("Plan illisible."));
+		return;
 	}
 
-	QFile voicesFilesNotFound("logs/voicesFilesNotFound.log");
-	if (voicesFilesNotFound.open(QFile::WriteOnly | QFile::Text))
+	if (!frenchiser.getStalePlanSources().isEmpty())
 	{
-		QTextStream out(&voicesFilesNotFound);
-		QList<QString> foundFiles;
-		for (const MatchingFile& matchingFile : matchingFiles)
+		ui->statusbar->showMessage(tr("VF modifiées depuis le plan, non copiées : ") + QString::number(frenchiser.getStalePlanSources().size()));
+	}
+	// Directement à la copie, comme après planOutputs()
+	s3PlanOutputsFinished();
+}
+
+bool MainWindow::isBusy() const
+{
+	// Les watchers ne sont finis qu'une fois leur slot appelé : pas de trou entre deux étapes
+	return !s1ProcessFolderFutureWatcher.isFinished() || !s2ProcessVoiceFolderFutureWatcher.isFinished()
+		|| !s3ProcessVoiceFutureWatcher.isFinished() || !s3PlanOutputsFutureWatcher.isFinished()
+		|| !s3ProcessReplaceVoiceFutureWatcher.isFinished() || !applyPlanFutureWatcher.isFinished()
+		|| !watchFutureWatcher.isFinished();
+}
+
+bool MainWindow::isStage3Running() const
+{
+	return !s3ProcessVoiceFutureWatcher.isFinished() || !s3PlanOutputsFutureWatcher.isFinished()
+		|| !s3ProcessReplaceVoiceFutureWatcher.isFinished() || !applyPlanFutureWatcher.isFinished()
+		|| !watchFutureWatcher.isFinished() || voiceWatcher.isActive();
+}
+
+void MainWindow::setScanEnabled(bool enabled)
+{
+	ui->runAllPushButton->setEnabled(enabled);
+	ui->applyPlanPushButton->setEnabled(enabled);
+	ui->s1GroupBox->setEnabled(enabled);
+	ui->s2GroupBox->setEnabled(enabled);
+}
+
+void MainWindow::stopWatchForScan()
+{
+	// La nouvelle analyse remplacera les listes de la dernière passe : plus rien à surveiller
+	// avant la prochaine étape 3
+	watchVoiceFolder.clear();
+	startWatch();
+}
+
+void MainWindow::startWatch()
+{
+	if (!ui->s3WatchCheckBox->isChecked() || watchVoiceFolder.isEmpty())
+	{
+		voiceWatcher.stop();
+		pendingWatchFolders.clear();
+		return;
+	}
+	if (!voiceWatcher.start(watchVoiceFolder))
+	{
+		ui->statusbar->showMessage(tr("Impossible de surveiller ") + watchVoiceFolder);
+		return;
+	}
+	// Ce qui a changé pendant la passe n'y figure peut-être pas
+	if (!pendingWatchFolders.isEmpty())
+	{
+		voiceFoldersChanged(QStringList());
+	}
+}
+
+void MainWindow::on_s3WatchCheckBox_toggled(bool checked)
+{
+	settings.setValue("s3Watch", checked);
+	startWatch();
+	// Pendant une étape, c'est sa fin qui décide
+	if (!isBusy())
+	{
+		setScanEnabled(!voiceWatcher.isActive());
+	}
+}
+
+void MainWindow::voiceFoldersChanged(const QStringList& folderPaths)
+{
+	for (const QString& folderPath : folderPaths)
+	{
+		if (!pendingWatchFolders.contains(folderPath))
 		{
-			if (matchingFile.voiceFile)
-			{
-				foundFiles.append(matchingFile.voiceFile->filePath);
-			}
+			pendingWatchFolders.append(folderPath);
 		}
+	}
+	if (isBusy() || pendingWatchFolders.isEmpty() || !voiceWatcher.isActive())
+	{
+		return;
+	}
 
-		for (const VoiceFile& voiceFile : voiceFiles)
-		{
-			if (!foundFiles.contains(voiceFile.filePath))
+	// Quelques millisecondes : l'interface est juste figée le temps de la mise à jour
+	waitForReports();
+	ui->centralwidget->setEnabled(false);
+	frenchiser.resetReplaceCounts();
+	watchFuture = QtConcurrent::run(&Frenchiser::updateVoiceFolders, &frenchiser, pendingWatchFolders, s3OutputFolder, s3Sync);
+	watchFutureWatcher.setFuture(watchFuture);
+	pendingWatchFolders.clear();
+}
+
+void MainWindow::watchUpdated()
+{
+	ui->centralwidget->setEnabled(true);
+	const Frenchiser::WatchUpdate update = watchFuture.result();
+	if (update.voiceFileCount > 0)
+	{
+		// Logs et rapport décrivent l'état après cette mise à jour, pas la passe complète
+		reportFutures.append(QtConcurrent::run(
+			[this, inputFolder = watchVoiceFolder]()
 			{
-				out << voiceFile.correspondingName << "\t" << voiceFile.filePath << Qt::endl;
+				frenchiser.writeFrenchFilesLog(inputFolder);
+				frenchiser.writeMatchingLogs();
+				frenchiser.writeRunReport();
 			}
-		}
-		voicesFilesNotFound.close();
+		));
+	}
+	ui->statusbar->showMessage(tr("Surveillance : %1 VF changées, %2 voix revues, %3 écrites, %4 supprimées, %5 échecs")
+		.arg(update.voiceFileCount)
+		.arg(update.wemFileCount)
+		.arg(frenchiser.getReplaceCount(Frenchiser::Copied) + frenchiser.getReplaceCount(Frenchiser::Updated))
+		.arg(update.removedCount)
+		.arg(frenchiser.getReplaceCount(Frenchiser::ReplaceFailed)));
+
+	if (!pendingWatchFolders.isEmpty())
+	{
+		voiceFoldersChanged(QStringList());
 	}
 }
 
-void MainWindow::s3ProcessReplaceVoicesFinished()
+void MainWindow::showProgress(bool visible)
 {
-	ui->s3ReplaceVoicesGroupBox->setEnabled(true);
-	ui->progressBar->setVisible(false);
+	ui->progressBar->setVisible(visible);
+	if (visible)
+	{
+		updateProgress();
+		progressTimer.start();
+	}
+	else
+	{
+		progressTimer.stop();
+	}
+}
+
+void MainWindow::updateProgress()
+{
+	const Progress::Sample sample = frenchiser.getProgress().sample();
+	if (sample.total <= 0)
+	{
+		// Parcours en cours : total inconnu, barre animée et compteur seul
+		ui->progressBar->setRange(0, 0);
+		if (sample.done > 0)
+		{
+			ui->statusbar->showMessage(tr("%1 fichiers (%2/s)").arg(sample.done).arg(qRound64(sample.itemsPerSecond)));
+		}
+		return;
+	}
 
-	QMessageBox::information(this, tr("Terminé"), tr("Les voix ont été remplacées avec succès."));
+	ui->progressBar->setRange(0, int(qMin<qint64>(sample.total, INT_MAX)));
+	ui->progressBar->setValue(int(qMin(sample.done, sample.total)));
+	QString message = tr("%1 / %2 (%3/s)").arg(sample.done).arg(sample.total).arg(qRound64(sample.itemsPerSecond));
+	if (sample.remainingMs >= 0)
+	{
+		message += " - " + tr("encore %1 s").arg((sample.remainingMs + 999) / 1000);
+	}
+	ui->statusbar->showMessage(message);
 }
@@ -6,6 +6,10 @@
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QSettings>
+#include <QTimer>
+
+#include "Frenchiser.h"
+#include "VoiceWatcher.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -13,26 +17,6 @@ class MainWindow;
 }
 QT_END_NAMESPACE
 
-struct WemFile
-{
-	QString filePath;
-	unsigned int id;
-	QString codec;
-};
-
-struct VoiceFile
-{
-	QString filePath;
-	QString correspondingName;
-};
-
-struct MatchingFile
-{
-	const WemFile* wemFile = nullptr;
-	bool found = false;
-	const VoiceFile* voiceFile = nullptr;
-};
-
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -46,46 +30,67 @@ private:
 
 	QSettings settings;
 
-	const QHash<QString, QVector<QString>> correspondingRaces;
-	const QStringList subFolders;
-	const QHash<QString, QString> shittyReplace;
-
-	QList<WemFile> wemFiles;
-	QList<VoiceFile> voiceFiles;
-
-	QHash<QString, WemFile*> wemByCodec;
-	QHash<QString, WemFile*> wemByBaseNames;
-	QHash<QString, VoiceFile*> voiceFileByBaseNames;
-	QList<MatchingFile> matchingFiles;
-	QHash<QString, QList<VoiceFile*>> voiceFileByLineIds;
-
-	QStringList getFilesInFolder(const QString& folderPath, const QStringList& fileSuffixes);
-	QString getLineId(const QString& filePath) const;
-	QString getFullLineId(const QString& filePath) const;
-	QChar getSex(const QString& filePath) const;
+	Frenchiser frenchiser;
+
+	bool runAll = false;
+	int runAllPendingStages = 0;
+	// Non vide : l'étape 3 s'arrête au plan, enregistré ici au lieu de copier
+	QString planPath;
+	bool applyingPlan = false;
+	bool checkFolder(const QString& folder, bool output);
+	void runAllStageFinished();
+	void s1Start(const QString& inputFolder);
+	void s2Start(const QString& inputFolder);
+	void s3Start(const QString& outputFolder);
+	// Réglages de l'étape 3 lus une fois dans les widgets, avant de lancer les threads
+	void s3Snapshot(const QString& outputFolder);
+	QString s3OutputFolder;
+	bool s3Sync = false;
+
+	// Mode surveillance : démarré après un remplacement complet, sur le dossier VF de l'étape 2
+	VoiceWatcher voiceWatcher;
+	QString watchVoiceFolder;
+	// Dossiers signalés pendant qu'une étape tournait, repris dès qu'elle est finie
+	QStringList pendingWatchFolders;
+	bool isBusy() const;
+	// Étape 3 ou surveillance en cours : elles lisent les listes que les analyses remplacent
+	bool isStage3Running() const;
+	// Analyses, tout-en-un et application d'un plan : tout ce qui remplace ces listes
+	void setScanEnabled(bool enabled);
+	void stopWatchForScan();
+	void startWatch();
+
+	// Relevé périodique des compteurs du moteur, plutôt qu'un signal par fichier
+	QTimer progressTimer;
+	void showProgress(bool visible);
 
     QFuture<QList<WemFile>> s1ProcessFolderFuture;
 	QFutureWatcher<QList<WemFile>> s1ProcessFolderFutureWatcher;
 	QList<WemFile> s1ProcessFolder(const QString& folderPath);
-	QFuture<WemFile> s1ProcessFilesFuture;
-	QFutureWatcher<WemFile> s1ProcessFilesFutureWatcher;
-	WemFile s1ProcessFile(const QString& filePath);
 
-	QFuture<QStringList> s2ProcessVoiceFolderFuture;
-	QFutureWatcher<QStringList> s2ProcessVoiceFolderFutureWatcher;
-	QStringList s2ProcessVoiceFolder(const QString& folderPath);
-	QFuture<VoiceFile> s2ProcessVoiceFilesFuture;
-	QFutureWatcher<VoiceFile> s2ProcessVoiceFilesFutureWatcher;
-	VoiceFile s2ProcessVoiceFile(const QString& filePath);
+	QFuture<QList<VoiceFile>> s2ProcessVoiceFolderFuture;
+	QFutureWatcher<QList<VoiceFile>> s2ProcessVoiceFolderFutureWatcher;
 
 	QFuture<MatchingFile> s3ProcessVoiceFuture;
 	QFutureWatcher<MatchingFile> s3ProcessVoiceFutureWatcher;
-	MatchingFile s3ProcessVoice(const WemFile& wemFile);
+	QFuture<void> s3PlanOutputsFuture;
+	QFutureWatcher<void> s3PlanOutputsFutureWatcher;
 	QFuture<void> s3ProcessReplaceVoiceFuture;
 	QFutureWatcher<void> s3ProcessReplaceVoiceFutureWatcher;
-	void replaceVoice(const MatchingFile& matchingFile, const QString& outputFolder);
+	QFuture<bool> applyPlanFuture;
+	QFutureWatcher<bool> applyPlanFutureWatcher;
+	QFuture<Frenchiser::WatchUpdate> watchFuture;
+	QFutureWatcher<Frenchiser::WatchUpdate> watchFutureWatcher;
+
+	// Logs et caches écrits hors du thread de l'interface
+	QList<QFuture<void>> reportFutures;
+	void waitForReports();
 
 private slots:
+	void updateProgress();
+
+	void on_runAllPushButton_clicked();
+
 	void on_s1InputFolderPushButton_clicked();
 	void on_s1ProcessPushButton_clicked();
 	void s1ProcessFinished();
@@ -93,11 +98,19 @@ private slots:
 	void on_s2InputFolderPushButton_clicked();
 	void on_s2ProcessPushButton_clicked();
 	void s2ProcessVoiceFolderFinished();
-	void s2ProcessVoiceFilesFinished();
 
 	void on_s3OutputFolderPushButton_clicked();
 	void on_s3ReplaceVoicesPushButton_clicked();
+	void on_s3SavePlanPushButton_clicked();
 	void s3ProcessVoicesFinished();
+	void s3PlanOutputsFinished();
 	void s3ProcessReplaceVoicesFinished();
+
+	void on_applyPlanPushButton_clicked();
+	void applyPlanLoaded();
+
+	void on_s3WatchCheckBox_toggled(bool checked);
+	void voiceFoldersChanged(const QStringList& folderPaths);
+	void watchUpdated();
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,92 @@
+#include "PathPool.h"
+
+#include <QMutexLocker>
+
+PathPool::Id PathPool::add(QStringView filePath)
+{
+	const qsizetype slash = filePath.lastIndexOf('/');
+	const QStringView directory = slash < 0 ? QStringView() : filePath.first(slash);
+	const QStringView fileName = filePath.mid(slash + 1);
+
+	QMutexLocker locker(&mutex);
+	Entry entry;
+	const auto it = directoryIds.constFind(directory);
+	if (it != directoryIds.constEnd())
+	{
+		entry.directory = *it;
+	}
+	else
+	{
+		// Comme pour les tokens de VoiceMatcher : les vues pointent dans directories,
+		// dont les données ne bougent plus
+		entry.directory = quint32(directories.size());
+		directories.append(directory.toString());
+		directoryIds.insert(QStringView(directories.last()), entry.directory);
+	}
+	entry.nameOffset = quint32(names.size());
+	entry.nameLength = quint32(fileName.size());
+	names.append(fileName);
+	entries.append(entry);
+	return Id(entries.size() - 1);
+}
+
+void PathPool::clear()
+{
+	QMutexLocker locker(&mutex);
+	directories.clear();
+	directoryIds.clear();
+	names.clear();
+	entries.clear();
+}
+
+void PathPool::swap(PathPool& other)
+{
+	if (this == &other)
+	{
+		return;
+	}
+	QMutexLocker locker(&mutex);
+	QMutexLocker otherLocker(&other.mutex);
+	directories.swap(other.directories);
+	directoryIds.swap(other.directoryIds);
+	names.swap(other.names);
+	entries.swap(other.entries);
+}
+
+QString PathPool::filePath(Id id) const
+{
+	const Entry& entry = entries[id];
+	const QString& directory = directories[entry.directory];
+	if (directory.isEmpty())
+	{
+		return fileName(id).toString();
+	}
+	QString result;
+	result.reserve(directory.size() + 1 + entry.nameLength);
+	result.append(directory);
+	result.append('/');
+	result.append(fileName(id));
+	return result;
+}
+
+QStringView PathPool::fileName(Id id) const
+{
+	const Entry& entry = entries[id];
+	return QStringView(names).sliced(entry.nameOffset, entry.nameLength);
+}
+
+QStringView PathPool::directory(Id id) const
+{
+	return directories[entries[id].directory];
+}
+
+bool PathPool::lessThan(Id left, Id right) const
+{
+	const Entry& leftEntry = entries[left];
+	const Entry& rightEntry = entries[right];
+	if (leftEntry.directory != rightEntry.directory)
+	{
+		return directories[leftEntry.directory] < directories[rightEntry.directory];
+	}
+	return fileName(left) < fileName(right);
+}
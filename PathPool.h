@@ -0,0 +1,48 @@
+#ifndef PATHPOOL_H
+#define PATHPOOL_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+
+// Stockage compact des chemins d'un index : chaque dossier n'est gardé qu'une fois,
+// les noms de fichiers sont mis bout à bout dans une seule chaîne et un chemin n'est plus
+// qu'un entier. À un million de fichiers, on évite autant de QString qui répètent
+// le même long préfixe.
+// add() peut être appelé depuis plusieurs threads ; les lectures ne doivent pas
+// chevaucher un add().
+class PathPool
+{
+public:
+	using Id = quint32;
+
+	Id add(QStringView filePath);
+	void clear();
+	void swap(PathPool& other);
+	qsizetype size() const { return entries.size(); }
+
+	QString filePath(Id id) const;
+	QStringView fileName(Id id) const;
+	QStringView directory(Id id) const;
+	// Ordre par dossier puis par nom, sans reconstruire les chemins
+	bool lessThan(Id left, Id right) const;
+
+private:
+	struct Entry
+	{
+		quint32 directory = 0;
+		quint32 nameOffset = 0;
+		quint32 nameLength = 0;
+	};
+
+	QMutex mutex;
+	QStringList directories;
+	QHash<QStringView, quint32> directoryIds;
+	QString names;
+	QList<Entry> entries;
+};
+
+#endif // PATHPOOL_H
@@ -0,0 +1,26 @@
+#include "Progress.h"
+
+void Progress::reset(qint64 total)
+{
+	done = 0;
+	this->total = total;
+	timer.start();
+}
+
+Progress::Sample Progress::sample() const
+{
+	Sample result;
+	result.done = done.load(std::memory_order_relaxed);
+	result.total = total.load(std::memory_order_relaxed);
+	const qint64 elapsedMs = timer.isValid() ? timer.elapsed() : 0;
+	if (elapsedMs > 0)
+	{
+		// Débit moyen depuis reset() : plus stable que l'écart entre deux relevés
+		result.itemsPerSecond = double(result.done) * 1000.0 / double(elapsedMs);
+	}
+	if (result.total > 0 && result.itemsPerSecond > 0.0)
+	{
+		result.remainingMs = qint64(double(qMax<qint64>(result.total - result.done, 0)) * 1000.0 / result.itemsPerSecond);
+	}
+	return result;
+}
@@ -0,0 +1,34 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <QElapsedTimer>
+
+#include <atomic>
+
+// Avancement d'une étape : les threads de travail incrémentent des compteurs atomiques,
+// sans verrou ni signal par fichier, et l'interface les relit à son rythme avec sample().
+// reset() et sample() sont réservés au thread qui affiche l'avancement.
+class Progress
+{
+public:
+	struct Sample
+	{
+		qint64 done = 0;
+		// 0 si inconnu (parcours en cours)
+		qint64 total = 0;
+		double itemsPerSecond = 0.0;
+		// -1 si inconnu
+		qint64 remainingMs = -1;
+	};
+
+	void reset(qint64 total = 0);
+	void add(qint64 count = 1) { done.fetch_add(count, std::memory_order_relaxed); }
+	Sample sample() const;
+
+private:
+	std::atomic<qint64> done { 0 };
+	std::atomic<qint64> total { 0 };
+	QElapsedTimer timer;
+};
+
+#endif // PROGRESS_H
@@ -0,0 +1,147 @@
+#include "RunReport.h"
+
+#include "Trace.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QTextStream>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+namespace
+{
+	void flatten(const QString& prefix, const QJsonValue& value, QTextStream& out)
+	{
+		if (value.isObject())
+		{
+			const QJsonObject object = value.toObject();
+			for (auto it = object.constBegin(); it != object.constEnd(); ++it)
+			{
+				flatten(prefix.isEmpty() ? it.key() : prefix + "." + it.key(), it.value(), out);
+			}
+		}
+		else if (value.isArray())
+		{
+			const QJsonArray array = value.toArray();
+			for (qsizetype i = 0; i < array.size(); i++)
+			{
+				flatten(prefix + "." + QString::number(i), array[i], out);
+			}
+		}
+		else
+		{
+			QString text = value.isString() ? value.toString() : value.isBool() ? QString(value.toBool() ? "true" : "false") : QString::number(value.toDouble(), 'g', 15);
+			// Les chemins et noms de race peuvent contenir des virgules
+			if (text.contains(',') || text.contains('"'))
+			{
+				text = "\"" + text.replace("\"", "\"\"") + "\"";
+			}
+			out << prefix << ',' << text << '\n';
+		}
+	}
+}
+
+void RunReport::begin(Phase phase)
+{
+	cpuStarts[phase] = processCpuTime();
+	traceStarts[phase] = Trace::isEnabled() ? Trace::now() : -1;
+	wallTimers[phase].start();
+}
+
+void RunReport::end(Phase phase)
+{
+	timings[phase].wallMs = wallTimers[phase].elapsed();
+	timings[phase].cpuMs = processCpuTime() - cpuStarts[phase];
+	if (traceStarts[phase] >= 0)
+	{
+		Trace::addSpan(phaseName(phase), Trace::Stage, traceStarts[phase]);
+	}
+}
+
+QJsonObject RunReport::timingsJson() const
+{
+	QJsonObject result;
+	for (int i = 0; i < PhaseCount; i++)
+	{
+		if (timings[i].wallMs < 0)
+		{
+			continue;
+		}
+		QJsonObject timing;
+		timing["wallMs"] = timings[i].wallMs;
+		timing["cpuMs"] = timings[i].cpuMs;
+		result[phaseName(Phase(i))] = timing;
+	}
+	return result;
+}
+
+const char* RunReport::phaseName(Phase phase)
+{
+	switch (phase)
+	{
+	case S1Scan: return "s1Scan";
+	case S1Banks: return "s1Banks";
+	case S1Index: return "s1Index";
+	case S2Scan: return "s2Scan";
+	case S2Index: return "s2Index";
+	case S3Match: return "s3Match";
+	case S3Plan: return "s3Plan";
+	case S3Copy: return "s3Copy";
+	case PhaseCount: break;
+	}
+	return "";
+}
+
+qint64 RunReport::processCpuTime()
+{
+#if defined(Q_OS_UNIX)
+	struct rusage usage;
+	if (::getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+	return (qint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#elif defined(Q_OS_WIN)
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		return 0;
+	}
+	// Unités de 100 ns
+	const quint64 kernel = (quint64(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+	const quint64 user = (quint64(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+	return qint64((kernel + user) / 10000);
+#else
+	return 0;
+#endif
+}
+
+bool RunReport::writeJson(const QString& filePath, const QJsonObject& report)
+{
+	QSaveFile file(filePath);
+	if (!file.open(QFile::WriteOnly))
+	{
+		return false;
+	}
+	file.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+	return file.commit();
+}
+
+bool RunReport::writeCsv(const QString& filePath, const QJsonObject& report)
+{
+	QSaveFile file(filePath);
+	if (!file.open(QFile::WriteOnly | QFile::Text))
+	{
+		return false;
+	}
+	QTextStream out(&file);
+	out << "key,value" << '\n';
+	flatten(QString(), report, out);
+	out.flush();
+	return file.commit();
+}
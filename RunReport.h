@@ -0,0 +1,68 @@
+#ifndef RUNREPORT_H
+#define RUNREPORT_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+
+// Durées de chaque phase (temps réel et temps CPU du processus) et écriture du rapport
+// de fin de lancement, en JSON et en CSV clé,valeur pour comparer deux dumps.
+// Chaque phase n'est mesurée que par un thread à la fois ; deux phases différentes
+// peuvent tourner en même temps (étapes 1 et 2 lancées ensemble), leur temps CPU se recouvre alors.
+// Quand la trace est active, chaque phase y apparaît aussi, sur le thread qui l'a terminée.
+class RunReport
+{
+public:
+	enum Phase
+	{
+		S1Scan,
+		S1Banks,
+		S1Index,
+		S2Scan,
+		S2Index,
+		S3Match,
+		S3Plan,
+		S3Copy,
+		PhaseCount
+	};
+
+	struct Timing
+	{
+		qint64 wallMs = -1;
+		qint64 cpuMs = -1;
+	};
+
+	class Scope
+	{
+	public:
+		Scope(RunReport& runReport, Phase phase) : runReport(runReport), phase(phase) { runReport.begin(phase); }
+		~Scope() { runReport.end(phase); }
+
+	private:
+		RunReport& runReport;
+		Phase phase;
+	};
+
+	void begin(Phase phase);
+	void end(Phase phase);
+	const Timing& getTiming(Phase phase) const { return timings[phase]; }
+	// Objet "timings" du rapport : une entrée par phase mesurée
+	QJsonObject timingsJson() const;
+
+	static const char* phaseName(Phase phase);
+	// Temps CPU cumulé de tous les threads du processus, en millisecondes
+	static qint64 processCpuTime();
+
+	static bool writeJson(const QString& filePath, const QJsonObject& report);
+	// Une ligne par valeur, clés imbriquées jointes par des points ("s3.copy.bytes,1234")
+	static bool writeCsv(const QString& filePath, const QJsonObject& report);
+
+private:
+	QElapsedTimer wallTimers[PhaseCount];
+	qint64 cpuStarts[PhaseCount] = {};
+	// -1 : trace désactivée au début de la phase
+	qint64 traceStarts[PhaseCount] = {};
+	Timing timings[PhaseCount];
+};
+
+#endif // RUNREPORT_H
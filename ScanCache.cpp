@@ -0,0 +1,169 @@
+#include "ScanCache.h"
+
+#include <QByteArrayView>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace
+{
+	const QByteArrayView cacheMagic("OFSC");
+	const quint32 cacheVersion = 1;
+
+	template <typename T>
+	bool readValue(QByteArrayView data, qsizetype& pos, T& value)
+	{
+		if (pos + qsizetype(sizeof(T)) > data.size())
+		{
+			return false;
+		}
+		value = qFromLittleEndian<T>(data.data() + pos);
+		pos += sizeof(T);
+		return true;
+	}
+
+	bool readBytes(QByteArrayView data, qsizetype& pos, QByteArrayView& bytes)
+	{
+		quint32 size = 0;
+		if (!readValue(data, pos, size) || pos + qsizetype(size) > data.size())
+		{
+			return false;
+		}
+		bytes = data.sliced(pos, size);
+		pos += size;
+		return true;
+	}
+
+	template <typename T>
+	void writeValue(QByteArray& data, T value)
+	{
+		const T littleEndian = qToLittleEndian(value);
+		data.append(reinterpret_cast<const char*>(&littleEndian), sizeof(T));
+	}
+
+	void writeBytes(QByteArray& data, const QByteArray& bytes)
+	{
+		writeValue<quint32>(data, quint32(bytes.size()));
+		data.append(bytes);
+	}
+}
+
+bool ScanCache::load(const QString& filePath)
+{
+	this->filePath = filePath;
+	entries.clear();
+	seenEntries.clear();
+	scanRoots.clear();
+
+	// Toutes les entrées sont recopiées dans la table : une seule lecture, sans mappage
+	QFile file(filePath);
+	if (!file.open(QFile::ReadOnly))
+	{
+		return false;
+	}
+	const QByteArray data = file.readAll();
+	file.close();
+
+	qsizetype pos = cacheMagic.size();
+	quint32 version = 0, count = 0;
+	if (!data.startsWith(cacheMagic) || !readValue(data, pos, version) || version != cacheVersion
+		|| !readValue(data, pos, count))
+	{
+		return false;
+	}
+
+	entries.reserve(count);
+	for (quint32 i = 0; i < count; i++)
+	{
+		QByteArrayView path, text;
+		Entry entry;
+		if (!readBytes(data, pos, path) || !readValue(data, pos, entry.size)
+			|| !readValue(data, pos, entry.lastModified) || !readValue(data, pos, entry.id)
+			|| !readBytes(data, pos, text))
+		{
+			entries.clear();
+			return false;
+		}
+		entry.text = QString::fromUtf8(text);
+		entries.insert(QString::fromUtf8(path), entry);
+	}
+	return true;
+}
+
+bool ScanCache::save()
+{
+	if (filePath.isEmpty())
+	{
+		return false;
+	}
+
+	// Hors des dossiers parcourus, rien ne dit qu'un fichier a disparu : l'entrée reste
+	for (auto it = entries.constBegin(); it != entries.constEnd(); ++it)
+	{
+		const bool scanned = std::any_of(scanRoots.constBegin(), scanRoots.constEnd(),
+			[&it](const QString& scanRoot)
+			{
+				return it.key().startsWith(scanRoot + "/");
+			}
+		);
+		if (!scanned && !seenEntries.contains(it.key()))
+		{
+			seenEntries.insert(it.key(), it.value());
+		}
+	}
+
+	QByteArray data;
+	data.append(cacheMagic.data(), cacheMagic.size());
+	writeValue<quint32>(data, cacheVersion);
+	writeValue<quint32>(data, quint32(seenEntries.size()));
+	for (auto it = seenEntries.constBegin(); it != seenEntries.constEnd(); ++it)
+	{
+		writeBytes(data, it.key().toUtf8());
+		writeValue<qint64>(data, it->size);
+		writeValue<qint64>(data, it->lastModified);
+		writeValue<quint32>(data, it->id);
+		writeBytes(data, it->text.toUtf8());
+	}
+
+	QSaveFile file(filePath);
+	if (!file.open(QFile::WriteOnly) || file.write(data) != data.size() || !file.commit())
+	{
+		return false;
+	}
+
+	entries.swap(seenEntries);
+	seenEntries.clear();
+	scanRoots.clear();
+	return true;
+}
+
+void ScanCache::addScanRoot(const QString& folderPath)
+{
+	QMutexLocker locker(&seenMutex);
+	scanRoots.append(folderPath);
+}
+
+bool ScanCache::find(const QString& path, qint64 size, qint64 lastModified, Entry& entry)
+{
+	const auto it = entries.constFind(path);
+	if (it == entries.constEnd() || it->size != size || it->lastModified != lastModified)
+	{
+		return false;
+	}
+	entry = *it;
+	insert(path, entry);
+	return true;
+}
+
+void ScanCache::insert(const QString& path, const Entry& entry)
+{
+	if (filePath.isEmpty())
+	{
+		return;
+	}
+	QMutexLocker locker(&seenMutex);
+	seenEntries.insert(path, entry);
+}
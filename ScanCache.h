@@ -0,0 +1,44 @@
+#ifndef SCANCACHE_H
+#define SCANCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+// Cache disque des fichiers déjà analysés, indexé par chemin + taille + date de modification.
+// Le fichier est lu en une fois au chargement. Sous les dossiers parcourus pendant la passe
+// (addScanRoot), seules les entrées vues (retrouvées ou nouvelles) sont réécrites par save() :
+// les fichiers disparus sortent donc du cache d'eux-mêmes. Les entrées d'autres dossiers
+// (un autre dump) sont gardées telles quelles.
+class ScanCache
+{
+public:
+	struct Entry
+	{
+		qint64 size = 0;
+		qint64 lastModified = 0;
+		quint32 id = 0;
+		QString text;
+	};
+
+	bool load(const QString& filePath);
+	bool save();
+	// Dossier parcouru en entier pendant cette passe
+	void addScanRoot(const QString& folderPath);
+
+	bool find(const QString& path, qint64 size, qint64 lastModified, Entry& entry);
+	void insert(const QString& path, const Entry& entry);
+
+	qsizetype size() const { return entries.size(); }
+
+private:
+	QString filePath;
+	QHash<QString, Entry> entries;
+
+	QMutex seenMutex;
+	QHash<QString, Entry> seenEntries;
+	QStringList scanRoots;
+};
+
+#endif // SCANCACHE_H
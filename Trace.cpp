@@ -0,0 +1,242 @@
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		const char* name = nullptr;
+		Trace::Category category = Trace::Stage;
+		QString detail;
+		qint64 startNs = 0;
+		qint64 durationNs = 0;
+	};
+
+	// Écrit seulement par son thread ; relu par writeJson() une fois les traitements terminés
+	struct Buffer
+	{
+		int threadIndex = 0;
+		QString threadName;
+		std::vector<Event> events;
+		// Total depuis start() : au-delà de la taille du tampon, les plus anciens ont été écrasés
+		quint64 written = 0;
+	};
+
+	struct ThreadState
+	{
+		Buffer* buffer = nullptr;
+		quint64 fileCount = 0;
+		bool fileSampled = false;
+	};
+
+	// Les tampons ne sont jamais libérés : un thread du pool garde le sien d'un lancement à l'autre
+	QMutex buffersMutex;
+	std::vector<std::unique_ptr<Buffer>> buffers;
+	std::atomic<qint64> originNs { 0 };
+	std::atomic<int> fileSampleInterval { 64 };
+	std::atomic<int> eventCapacity { 65536 };
+	thread_local ThreadState threadState;
+
+	qint64 clockNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	Buffer* threadBuffer()
+	{
+		if (threadState.buffer == nullptr)
+		{
+			auto buffer = std::make_unique<Buffer>();
+			const QThread* thread = QThread::currentThread();
+			QMutexLocker locker(&buffersMutex);
+			buffer->threadIndex = int(buffers.size()) + 1;
+			if (QCoreApplication::instance() != nullptr && thread == QCoreApplication::instance()->thread())
+			{
+				buffer->threadName = "main";
+			}
+			else
+			{
+				// Les threads du pool portent tous le même nom
+				buffer->threadName = (thread->objectName().isEmpty() ? QString("Thread") : thread->objectName()) + " " + QString::number(buffer->threadIndex);
+			}
+			threadState.buffer = buffer.get();
+			buffers.push_back(std::move(buffer));
+		}
+		return threadState.buffer;
+	}
+
+	const char* categoryName(Trace::Category category)
+	{
+		switch (category)
+		{
+		case Trace::Stage: return "stage";
+		case Trace::File: return "file";
+		case Trace::Operation: return "operation";
+		}
+		return "";
+	}
+
+	QByteArray jsonString(const QString& text)
+	{
+		QByteArray result = "\"";
+		for (const char c : text.toUtf8())
+		{
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+				result += c;
+			}
+			else if (uchar(c) < 0x20)
+			{
+				result += "\\u00" + QByteArray::number(uchar(c), 16).rightJustified(2, '0');
+			}
+			else
+			{
+				result += c;
+			}
+		}
+		result += '"';
+		return result;
+	}
+
+	// Microsecondes, unité des traces Chrome
+	QByteArray microseconds(qint64 ns)
+	{
+		return QByteArray::number(double(ns) / 1000.0, 'f', 3);
+	}
+}
+
+void Trace::Span::begin(const char* name, Category category, const QString& detail)
+{
+	this->category = category;
+	if (category == File)
+	{
+		// Un fichier non retenu coupe aussi ses opérations, d'où la restauration en fin de portée
+		previousSampled = threadState.fileSampled;
+		threadState.fileSampled = threadState.fileCount++ % quint64(fileSampleInterval.load(std::memory_order_relaxed)) == 0;
+		active = true;
+		if (!threadState.fileSampled)
+		{
+			return;
+		}
+	}
+	else if (category == Operation && !threadState.fileSampled)
+	{
+		return;
+	}
+	this->name = name;
+	this->detail = detail;
+	startNs = now();
+	active = true;
+}
+
+void Trace::Span::end()
+{
+	if (startNs >= 0)
+	{
+		addSpan(name, category, startNs, detail);
+	}
+	if (category == File)
+	{
+		threadState.fileSampled = previousSampled;
+	}
+}
+
+void Trace::start(int sampleInterval, int bufferSize)
+{
+	QMutexLocker locker(&buffersMutex);
+	for (const std::unique_ptr<Buffer>& buffer : buffers)
+	{
+		buffer->events.clear();
+		buffer->written = 0;
+	}
+	fileSampleInterval = qMax(1, sampleInterval);
+	eventCapacity = qMax(1, bufferSize);
+	originNs = clockNs();
+	enabled = true;
+}
+
+void Trace::stop()
+{
+	enabled = false;
+}
+
+qint64 Trace::now()
+{
+	return clockNs() - originNs.load(std::memory_order_relaxed);
+}
+
+void Trace::addSpan(const char* name, Category category, qint64 startNs, const QString& detail)
+{
+	Event event;
+	event.name = name;
+	event.category = category;
+	event.detail = detail;
+	event.startNs = startNs;
+	event.durationNs = now() - startNs;
+
+	Buffer* buffer = threadBuffer();
+	const size_t capacity = size_t(eventCapacity.load(std::memory_order_relaxed));
+	if (buffer->events.size() < capacity)
+	{
+		buffer->events.push_back(std::move(event));
+	}
+	else
+	{
+		buffer->events[buffer->written % capacity] = std::move(event);
+	}
+	buffer->written++;
+}
+
+bool Trace::writeJson(const QString& filePath)
+{
+	QSaveFile file(filePath);
+	if (!file.open(QFile::WriteOnly))
+	{
+		return false;
+	}
+
+	QMutexLocker locker(&buffersMutex);
+	quint64 droppedCount = 0;
+	bool first = true;
+	file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (const std::unique_ptr<Buffer>& buffer : buffers)
+	{
+		if (buffer->written == 0)
+		{
+			continue;
+		}
+		droppedCount += buffer->written - buffer->events.size();
+		const QByteArray tid = QByteArray::number(buffer->threadIndex);
+		QByteArray line = first ? "" : ",\n";
+		first = false;
+		line += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":" + jsonString(buffer->threadName) + "}}";
+		file.write(line);
+		for (const Event& event : buffer->events)
+		{
+			line = ",\n{\"name\":" + jsonString(QString::fromLatin1(event.name))
+				+ ",\"cat\":\"" + categoryName(event.category)
+				+ "\",\"ph\":\"X\",\"ts\":" + microseconds(event.startNs)
+				+ ",\"dur\":" + microseconds(event.durationNs)
+				+ ",\"pid\":1,\"tid\":" + tid;
+			if (!event.detail.isEmpty())
+			{
+				line += ",\"args\":{\"path\":" + jsonString(event.detail) + "}";
+			}
+			line += "}";
+			file.write(line);
+		}
+	}
+	file.write("\n],\"otherData\":{\"sampleInterval\":" + QByteArray::number(fileSampleInterval.load())
+		+ ",\"droppedEvents\":" + QByteArray::number(droppedCount) + "}}\n");
+	return file.commit();
+}
@@ -0,0 +1,75 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+#include <atomic>
+
+// Trace d'exécution au format Chrome (chrome://tracing, ui.perfetto.dev) : chaque thread note
+// ses intervalles dans son propre tampon circulaire, sans verrou, et les plus anciens sont
+// écrasés quand il est plein. Désactivée, un Span ne coûte qu'une lecture atomique.
+// Les étapes sont toujours notées ; les fichiers le sont un sur sampleInterval par thread,
+// avec le détail de leurs opérations (ouverture, lecture, analyse, recherche, copie).
+// start() et writeJson() ne sont appelés que lorsqu'aucun traitement ne tourne.
+class Trace
+{
+public:
+	enum Category
+	{
+		Stage,
+		// Traitement d'un fichier : décide si ses opérations sont notées
+		File,
+		// Notée seulement dans un fichier retenu par l'échantillonnage
+		Operation
+	};
+
+	class Span
+	{
+	public:
+		// name doit rester valide jusqu'à writeJson() (chaîne littérale) ; detail : chemin du fichier
+		Span(const char* name, Category category, const QString& detail = QString())
+		{
+			if (isEnabled())
+			{
+				begin(name, category, detail);
+			}
+		}
+		~Span()
+		{
+			if (active)
+			{
+				end();
+			}
+		}
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+	private:
+		void begin(const char* name, Category category, const QString& detail);
+		void end();
+
+		const char* name = nullptr;
+		Category category = Stage;
+		QString detail;
+		qint64 startNs = -1;
+		bool active = false;
+		bool previousSampled = false;
+	};
+
+	// Vide les tampons et active la trace ; bufferSize : nombre d'intervalles gardés par thread
+	static void start(int sampleInterval = 64, int bufferSize = 65536);
+	static void stop();
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	// Nanosecondes depuis start()
+	static qint64 now();
+	// Intervalle de startNs à maintenant, pour ce qui ne tient pas dans une portée (RunReport)
+	static void addSpan(const char* name, Category category, qint64 startNs, const QString& detail = QString());
+
+	static bool writeJson(const QString& filePath);
+
+private:
+	inline static std::atomic<bool> enabled { false };
+};
+
+#endif // TRACE_H
@@ -0,0 +1,127 @@
+#include "TxtpParser.h"
+
+#include <QObject>
+
+namespace
+{
+	const QByteArrayView wemSuffix(".wem");
+	const QByteArrayView pluginIdTag("ulPluginID:");
+
+	bool isPathSeparator(char c)
+	{
+		return c == '/' || c == '\\' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	// Nom du wem juste avant ".wem" : "wem/123456.wem" -> 123456
+	TxtpParser::Error parseWemId(QByteArrayView content, qsizetype wemPos, unsigned int& id)
+	{
+		qsizetype begin = wemPos;
+		while (begin > 0 && !isPathSeparator(content[begin - 1]))
+		{
+			begin--;
+		}
+		if (begin == wemPos)
+		{
+			return TxtpParser::InvalidWemId;
+		}
+
+		quint64 value = 0;
+		for (qsizetype i = begin; i < wemPos; i++)
+		{
+			const char c = content[i];
+			if (c < '0' || c > '9')
+			{
+				return TxtpParser::InvalidWemId;
+			}
+			value = value * 10 + (c - '0');
+			if (value > 0xFFFFFFFFu)
+			{
+				return TxtpParser::InvalidWemId;
+			}
+		}
+		id = static_cast<unsigned int>(value);
+		return TxtpParser::NoError;
+	}
+
+	// "ulPluginID: 0x00040001 [VORBIS]" -> VORBIS, sans sortir de la ligne
+	TxtpParser::Error parseCodec(QByteArrayView content, qsizetype tagEnd, QByteArrayView& codec)
+	{
+		qsizetype open = -1;
+		for (qsizetype i = tagEnd; i < content.size() && content[i] != '\n'; i++)
+		{
+			if (open < 0 && content[i] == '[')
+			{
+				open = i + 1;
+			}
+			else if (open >= 0 && content[i] == ']')
+			{
+				codec = content.sliced(open, i - open);
+				return codec.isEmpty() ? TxtpParser::MissingCodec : TxtpParser::NoError;
+			}
+		}
+		return TxtpParser::MissingCodec;
+	}
+}
+
+TxtpParser::Result TxtpParser::parse(QByteArrayView content)
+{
+	Result result;
+	bool idFound = false;
+	bool codecFound = false;
+
+	const qsizetype size = content.size();
+	for (qsizetype i = 0; i < size && !(idFound && codecFound); i++)
+	{
+		const char c = content[i];
+		if (!idFound && c == '.' && content.sliced(i).startsWith(wemSuffix))
+		{
+			result.error = parseWemId(content, i, result.id);
+			if (result.error != NoError)
+			{
+				return result;
+			}
+			idFound = true;
+			i += wemSuffix.size() - 1;
+		}
+		else if (!codecFound && c == 'u' && content.sliced(i).startsWith(pluginIdTag))
+		{
+			result.error = parseCodec(content, i + pluginIdTag.size(), result.codec);
+			if (result.error != NoError)
+			{
+				return result;
+			}
+			codecFound = true;
+			i += pluginIdTag.size() - 1;
+		}
+	}
+
+	if (!idFound)
+	{
+		result.error = MissingWem;
+	}
+	else if (!codecFound)
+	{
+		result.error = MissingPluginId;
+	}
+	return result;
+}
+
+QString TxtpParser::errorString(Error error)
+{
+	switch (error)
+	{
+	case NoError:
+		return QString();
+	case OpenError:
+		return QObject::tr("Impossible d'ouvrir le fichier");
+	case MissingWem:
+		return QObject::tr("Aucune référence .wem");
+	case InvalidWemId:
+		return QObject::tr("Id de wem invalide");
+	case MissingPluginId:
+		return QObject::tr("Aucun ulPluginID");
+	case MissingCodec:
+		return QObject::tr("Codec manquant après ulPluginID");
+	}
+	return QString();
+}
@@ -0,0 +1,33 @@
+#ifndef TXTPPARSER_H
+#define TXTPPARSER_H
+
+#include <QByteArrayView>
+#include <QString>
+
+// Lecture d'un txtp généré par Wwiser en une seule passe sur les octets bruts :
+// on s'arrête dès que l'id du wem et le codec (ulPluginID) sont trouvés.
+class TxtpParser
+{
+public:
+	enum Error
+	{
+		NoError,
+		OpenError,
+		MissingWem,
+		InvalidWemId,
+		MissingPluginId,
+		MissingCodec
+	};
+
+	struct Result
+	{
+		Error error = NoError;
+		unsigned int id = 0;
+		QByteArrayView codec;
+	};
+
+	static Result parse(QByteArrayView content);
+	static QString errorString(Error error);
+};
+
+#endif // TXTPPARSER_H
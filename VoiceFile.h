@@ -0,0 +1,24 @@
+#ifndef VOICEFILE_H
+#define VOICEFILE_H
+
+#include "AudioProbe.h"
+#include "PathPool.h"
+
+// VF analysée à l'étape 2 ; le chemin est dans le PathPool du moteur (Frenchiser::getVoiceFilePath)
+struct VoiceFile
+{
+	PathPool::Id path = 0;
+	// Lu dans les premiers octets du fichier à l'étape 2
+	AudioProbe::Codec codec = AudioProbe::UnknownCodec;
+	quint8 channels = 0;
+	quint32 sampleRate = 0;
+	quint32 durationMs = 0;
+	// Taille et date vues à l'étape 2 : le mode surveillance y repère les VF modifiées
+	qint64 size = 0;
+	qint64 lastModified = 0;
+	// Supprimée pendant la surveillance : sa place dans la liste est gardée, les indices du
+	// VoiceMatcher et les correspondances restent valables, mais elle n'est plus comptée
+	bool removed = false;
+};
+
+#endif // VOICEFILE_H
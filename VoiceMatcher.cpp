@@ -0,0 +1,540 @@
+#include "VoiceMatcher.h"
+
+#include "PathPool.h"
+#include "VoiceFile.h"
+
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+
+void VoiceMatcher::compile(const QHash<QString, QString>& replacements, const QStringList& subFolders, const QHash<QString, QVector<QString>>& correspondingRaces)
+{
+	this->replacements.clear();
+	races.clear();
+	maleToken = intern(u"m");
+	femaleToken = intern(u"f");
+
+	// "_alt01" -> "" : le motif suit un séparateur, il ne peut donc pas être le premier token
+	for (auto it = replacements.constBegin(); it != replacements.constEnd(); ++it)
+	{
+		Replacement replacement;
+		replacement.from = internAll(QStringView(it.key()).mid(it.key().startsWith('_') ? 1 : 0));
+		if (!it.value().isEmpty())
+		{
+			replacement.to = internAll(QStringView(it.value()).mid(it.value().startsWith('_') ? 1 : 0));
+		}
+		this->replacements.append(replacement);
+	}
+
+	// "_altvoice_" -> "_" : le sous-dossier est entouré de séparateurs
+	for (const QString& subFolder : subFolders)
+	{
+		Replacement replacement;
+		replacement.from = internAll(subFolder);
+		replacement.interior = true;
+		this->replacements.append(replacement);
+	}
+
+	for (auto it = correspondingRaces.constBegin(); it != correspondingRaces.constEnd(); ++it)
+	{
+		Race race;
+		race.name = it.key();
+		race.tokens = internAll(it.key());
+		for (const QString& target : it.value())
+		{
+			race.targetNames.append(target);
+			race.targets.append(internAll(target));
+		}
+		races.append(race);
+	}
+
+	// Ordre fixe (races composées d'abord) au lieu de l'ordre aléatoire des clés du QHash
+	std::stable_sort(races.begin(), races.end(),
+		[this](const Race& left, const Race& right)
+		{
+			if (left.tokens.size() != right.tokens.size())
+			{
+				return left.tokens.size() > right.tokens.size();
+			}
+			return std::lexicographical_compare(left.tokens.begin(), left.tokens.end(), right.tokens.begin(), right.tokens.end(),
+				[this](quint32 a, quint32 b)
+				{
+					return tokenStrings[a] < tokenStrings[b];
+				}
+			);
+		}
+	);
+}
+
+void VoiceMatcher::index(const QList<VoiceFile>& voiceFiles, const PathPool& voicePaths)
+{
+	struct VoiceKeys
+	{
+		quint32 voiceFile = 0;
+		QString name;
+		Tokens tokens;
+		bool known = false;
+		qsizetype sex = -1;
+		qsizetype lineId = -1;
+		size_t tokensHash = 0;
+		size_t suffixHash = 0;
+		size_t lineIdHash = 0;
+	};
+	QList<VoiceKeys> keys(voiceFiles.size());
+	for (qsizetype i = 0; i < keys.size(); i++)
+	{
+		keys[i].voiceFile = quint32(i);
+	}
+
+	// Noms d'event et découpage sur le pool : tokenIds n'est que lu pendant ce passage
+	QtConcurrent::blockingMap(keys,
+		[this, &voiceFiles, &voicePaths](VoiceKeys& voiceKeys)
+		{
+			voiceKeys.name = voiceName(voicePaths.filePath(voiceFiles[voiceKeys.voiceFile].path));
+			voiceKeys.known = tokenize(voiceKeys.name, voiceKeys.tokens);
+		}
+	);
+	// Seuls les noms qui contiennent un mot jamais vu passent par intern(), en série ;
+	// quand on réindexe le même dossier, il n'y en a plus
+	for (VoiceKeys& voiceKeys : keys)
+	{
+		if (!voiceKeys.known)
+		{
+			voiceKeys.tokens = internAll(voiceKeys.name);
+		}
+	}
+	QtConcurrent::blockingMap(keys,
+		[this](VoiceKeys& voiceKeys)
+		{
+			voiceKeys.name.clear();
+			const Tokens& tokens = voiceKeys.tokens;
+			voiceKeys.sex = sexIndex(tokens);
+			voiceKeys.lineId = lineIdIndex(tokens);
+			voiceKeys.tokensHash = qHash(tokens);
+			if (voiceKeys.sex >= 0 && voiceKeys.sex + 1 < tokens.size())
+			{
+				voiceKeys.suffixHash = qHash(Tokens(tokens.begin() + voiceKeys.sex + 1, tokens.end()));
+			}
+			if (voiceKeys.lineId >= 0)
+			{
+				voiceKeys.lineIdHash = qHash(tokens[voiceKeys.lineId]);
+			}
+		}
+	);
+
+	// Un lot par thread ; chaque lot parcourt toutes les voix dans l'ordre et ne garde que ses clés,
+	// les listes de candidats restent donc dans le même ordre qu'en série
+	const size_t shardCount = size_t(qMax(1, QThread::idealThreadCount()));
+	voiceFileByTokens.shards = QList<QHash<Tokens, quint32>>(shardCount);
+	voiceFilesBySuffix.shards = QList<QHash<Tokens, QList<FuzzyEntry>>>(shardCount);
+	voiceFilesByLineId.shards = QList<QHash<quint32, QList<FuzzyEntry>>>(shardCount);
+	QList<size_t> shards;
+	for (size_t shard = 0; shard < shardCount; shard++)
+	{
+		shards.append(shard);
+	}
+	QtConcurrent::blockingMap(shards,
+		[this, &keys, shardCount](size_t& shard)
+		{
+			QHash<Tokens, quint32>& byTokens = voiceFileByTokens.shards[shard];
+			QHash<Tokens, QList<FuzzyEntry>>& bySuffix = voiceFilesBySuffix.shards[shard];
+			QHash<quint32, QList<FuzzyEntry>>& byLineId = voiceFilesByLineId.shards[shard];
+			byTokens.reserve(keys.size() / shardCount + 1);
+			for (const VoiceKeys& voiceKeys : keys)
+			{
+				const Tokens& tokens = voiceKeys.tokens;
+				if (voiceKeys.tokensHash % shardCount == shard)
+				{
+					byTokens.insert(tokens, voiceKeys.voiceFile);
+				}
+
+				const FuzzyEntry entry = fuzzyEntry(voiceKeys.voiceFile, tokens, voiceKeys.sex, voiceKeys.lineId);
+				if (voiceKeys.lineId >= 0 && voiceKeys.lineIdHash % shardCount == shard)
+				{
+					byLineId[tokens[voiceKeys.lineId]].append(entry);
+				}
+				if (voiceKeys.sex >= 0 && voiceKeys.sex + 1 < tokens.size() && voiceKeys.suffixHash % shardCount == shard)
+				{
+					bySuffix[Tokens(tokens.begin() + voiceKeys.sex + 1, tokens.end())].append(entry);
+				}
+			}
+		}
+	);
+}
+
+void VoiceMatcher::insert(quint32 voiceFile, QStringView filePath)
+{
+	const Tokens tokens = internAll(voiceName(filePath));
+	voiceFileByTokens.shard(tokens).insert(tokens, voiceFile);
+	const qsizetype sex = sexIndex(tokens);
+	const qsizetype lineId = lineIdIndex(tokens);
+	const FuzzyEntry entry = fuzzyEntry(voiceFile, tokens, sex, lineId);
+	if (lineId >= 0)
+	{
+		voiceFilesByLineId.shard(tokens[lineId])[tokens[lineId]].append(entry);
+	}
+	if (sex >= 0 && sex + 1 < tokens.size())
+	{
+		const Tokens suffix(tokens.begin() + sex + 1, tokens.end());
+		voiceFilesBySuffix.shard(suffix)[suffix].append(entry);
+	}
+}
+
+void VoiceMatcher::remove(quint32 voiceFile, QStringView filePath)
+{
+	Tokens tokens;
+	if (!tokenize(voiceName(filePath), tokens))
+	{
+		// Un mot inconnu : la voix n'a jamais été indexée
+		return;
+	}
+	// Une autre VF de même nom, ailleurs dans l'arborescence, n'est pas remise à sa place :
+	// le prochain index() complet la retrouvera
+	QHash<Tokens, quint32>& byTokens = voiceFileByTokens.shard(tokens);
+	const auto it = byTokens.constFind(tokens);
+	if (it != byTokens.constEnd() && *it == voiceFile)
+	{
+		byTokens.erase(it);
+	}
+
+	const auto removeEntry = [voiceFile](QList<FuzzyEntry>& entries)
+	{
+		entries.removeIf(
+			[voiceFile](const FuzzyEntry& entry)
+			{
+				return entry.voiceFile == voiceFile;
+			}
+		);
+		return entries.isEmpty();
+	};
+	const qsizetype sex = sexIndex(tokens);
+	const qsizetype lineId = lineIdIndex(tokens);
+	if (lineId >= 0)
+	{
+		QHash<quint32, QList<FuzzyEntry>>& byLineId = voiceFilesByLineId.shard(tokens[lineId]);
+		const auto entries = byLineId.find(tokens[lineId]);
+		if (entries != byLineId.end() && removeEntry(*entries))
+		{
+			byLineId.erase(entries);
+		}
+	}
+	if (sex >= 0 && sex + 1 < tokens.size())
+	{
+		const Tokens suffix(tokens.begin() + sex + 1, tokens.end());
+		QHash<Tokens, QList<FuzzyEntry>>& bySuffix = voiceFilesBySuffix.shard(suffix);
+		const auto entries = bySuffix.find(suffix);
+		if (entries != bySuffix.end() && removeEntry(*entries))
+		{
+			bySuffix.erase(entries);
+		}
+	}
+}
+
+VoiceMatcher::FuzzyEntry VoiceMatcher::fuzzyEntry(quint32 voiceFile, const Tokens& tokens, qsizetype sex, qsizetype lineId)
+{
+	FuzzyEntry entry;
+	entry.voiceFile = voiceFile;
+	if (sex >= 0)
+	{
+		entry.sex = tokens[sex];
+	}
+	if (lineId >= 0 && lineId + 1 < tokens.size())
+	{
+		entry.response = tokens[lineId + 1];
+	}
+	return entry;
+}
+
+VoiceMatcher::Match VoiceMatcher::find(QStringView baseName) const
+{
+	Match result;
+	Tokens tokens;
+	tokenize(baseName, tokens);
+
+	const quint32* exact = voiceFileByTokens.find(tokens);
+	if (exact)
+	{
+		result.voiceFile = *exact;
+		result.rules = ExactRule;
+		return result;
+	}
+
+	quint8 rules = 0;
+	normalize(tokens, rules);
+
+	for (qsizetype raceIndex = 0; raceIndex < races.size(); raceIndex++)
+	{
+		const Race& race = races[raceIndex];
+		if (indexOf(tokens, race.tokens, 0, true) < 0)
+		{
+			continue;
+		}
+		for (qsizetype targetIndex = 0; targetIndex < race.targets.size(); targetIndex++)
+		{
+			const quint32* voiceFile = voiceFileByTokens.find(replaceAll(tokens, race.tokens, race.targets[targetIndex], true));
+			if (voiceFile)
+			{
+				result.voiceFile = *voiceFile;
+				result.rules = rules | RaceRule;
+				result.race = qint16(raceIndex);
+				result.raceTarget = qint16(targetIndex);
+				return result;
+			}
+		}
+	}
+	return result;
+}
+
+VoiceMatcher::FuzzyMatch VoiceMatcher::findFuzzy(QStringView baseName) const
+{
+	FuzzyMatch result;
+	Tokens tokens;
+	tokenize(baseName, tokens);
+	quint8 rules = 0;
+	normalize(tokens, rules);
+
+	const qsizetype sex = sexIndex(tokens);
+	const quint32 sexToken = sex >= 0 ? tokens[sex] : unknownToken;
+
+	// Même fin de nom (quête, sujet, id, réplique) : seuls la race ou le préfixe diffèrent
+	if (sex >= 0 && sex + 1 < tokens.size())
+	{
+		const QList<FuzzyEntry>* candidates = voiceFilesBySuffix.find(Tokens(tokens.begin() + sex + 1, tokens.end()));
+		if (candidates)
+		{
+			for (const FuzzyEntry& entry : *candidates)
+			{
+				if (entry.sex == sexToken)
+				{
+					result.voiceFile = entry.voiceFile;
+					result.confidence = 0.9f;
+					return result;
+				}
+			}
+			result.voiceFile = candidates->first().voiceFile;
+			result.confidence = 0.6f;
+			return result;
+		}
+	}
+
+	// Même id de réplique : on garde le candidat du même sexe et de la même réplique si possible
+	const qsizetype lineId = lineIdIndex(tokens);
+	if (lineId < 0)
+	{
+		return result;
+	}
+	const QList<FuzzyEntry>* candidates = voiceFilesByLineId.find(tokens[lineId]);
+	if (!candidates)
+	{
+		return result;
+	}
+	const quint32 response = lineId + 1 < tokens.size() ? tokens[lineId + 1] : unknownToken;
+	for (const FuzzyEntry& entry : *candidates)
+	{
+		const float confidence = 0.4f
+			+ (entry.sex == sexToken && sexToken != unknownToken ? 0.2f : 0.0f)
+			+ (entry.response == response && response != unknownToken ? 0.2f : 0.0f);
+		if (confidence > result.confidence)
+		{
+			result.voiceFile = entry.voiceFile;
+			result.confidence = confidence;
+		}
+	}
+	return result;
+}
+
+QString VoiceMatcher::raceTargetName(int race, int raceTarget) const
+{
+	if (race < 0 || race >= races.size() || raceTarget < 0 || raceTarget >= races[race].targetNames.size())
+	{
+		return QString();
+	}
+	return races[race].name + ">" + races[race].targetNames[raceTarget];
+}
+
+namespace
+{
+	const struct
+	{
+		VoiceMatcher::Rule rule;
+		const char16_t* name;
+	} ruleNameTable[] = {
+		{ VoiceMatcher::ExactRule, u"exact" },
+		{ VoiceMatcher::ReplaceRule, u"replace" },
+		{ VoiceMatcher::SubFolderRule, u"subFolder" },
+		{ VoiceMatcher::RaceRule, u"race" },
+		{ VoiceMatcher::FuzzyRule, u"fuzzy" }
+	};
+}
+
+QString VoiceMatcher::ruleNames(quint8 rules)
+{
+	QString result;
+	for (const auto& entry : ruleNameTable)
+	{
+		if (rules & entry.rule)
+		{
+			if (!result.isEmpty())
+			{
+				result += '+';
+			}
+			result += QStringView(entry.name);
+		}
+	}
+	return result;
+}
+
+quint8 VoiceMatcher::rulesFromNames(QStringView names)
+{
+	quint8 result = 0;
+	for (const QStringView name : names.split(u'+'))
+	{
+		for (const auto& entry : ruleNameTable)
+		{
+			if (name == QStringView(entry.name))
+			{
+				result |= entry.rule;
+			}
+		}
+	}
+	return result;
+}
+
+QString VoiceMatcher::voiceName(QStringView filePath)
+{
+	// Ce qui suit le dernier dossier de plugin (.esp ou .esm)
+	const qsizetype plugin = std::max(filePath.lastIndexOf(u".esp/"), filePath.lastIndexOf(u".esm/"));
+	QString name = filePath.mid(plugin < 0 ? 0 : plugin + 5).toString();
+	name.replace('/', '_');
+	name.replace(' ', '_');
+	name.prepend(u"Play_");
+	// Coupé à la première occurrence de l'extension, comme l'ancien split("." + suffixe)
+	const qsizetype dot = name.lastIndexOf('.');
+	if (dot >= 0)
+	{
+		name.truncate(name.indexOf(QStringView(name).sliced(dot)));
+	}
+	return name;
+}
+
+QStringView VoiceMatcher::baseName(QStringView filePath)
+{
+	QStringView fileName = filePath.mid(filePath.lastIndexOf('/') + 1);
+	if (fileName.endsWith(u"v.txtp"))
+	{
+		fileName.chop(6);
+	}
+	const qsizetype dot = fileName.indexOf('.');
+	return dot < 0 ? fileName : fileName.first(dot);
+}
+
+quint32 VoiceMatcher::intern(QStringView token)
+{
+	const auto it = tokenIds.constFind(token);
+	if (it != tokenIds.constEnd())
+	{
+		return *it;
+	}
+	// Les vues pointent dans tokenStrings, dont les données ne bougent plus
+	const quint32 id = quint32(tokenStrings.size());
+	tokenStrings.append(token.toString());
+	tokenIds.insert(QStringView(tokenStrings.last()), id);
+	return id;
+}
+
+VoiceMatcher::Tokens VoiceMatcher::internAll(QStringView name)
+{
+	Tokens tokens;
+	for (QStringView token : name.tokenize(u'_'))
+	{
+		tokens.append(intern(token));
+	}
+	return tokens;
+}
+
+bool VoiceMatcher::tokenize(QStringView name, Tokens& tokens) const
+{
+	bool known = true;
+	tokens.clear();
+	for (QStringView token : name.tokenize(u'_'))
+	{
+		const quint32 id = tokenIds.value(token, unknownToken);
+		known = known && id != unknownToken;
+		tokens.append(id);
+	}
+	return known;
+}
+
+void VoiceMatcher::normalize(Tokens& tokens, quint8& rules) const
+{
+	for (const Replacement& replacement : replacements)
+	{
+		if (replacement.from.isEmpty() || indexOf(tokens, replacement.from, 0, replacement.interior) < 0)
+		{
+			continue;
+		}
+		tokens = replaceAll(tokens, replacement.from, replacement.to, replacement.interior);
+		rules |= replacement.interior ? SubFolderRule : ReplaceRule;
+	}
+}
+
+qsizetype VoiceMatcher::sexIndex(const Tokens& tokens) const
+{
+	for (qsizetype i = tokens.size() - 1; i >= 0; i--)
+	{
+		if (tokens[i] == maleToken || tokens[i] == femaleToken)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+qsizetype VoiceMatcher::lineIdIndex(const Tokens& tokens) const
+{
+	// Comme getLineId : le dernier token de 8 caractères
+	for (qsizetype i = tokens.size() - 1; i >= 0; i--)
+	{
+		if (tokens[i] != unknownToken && tokenStrings[tokens[i]].size() == 8)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+qsizetype VoiceMatcher::indexOf(const Tokens& tokens, const Tokens& pattern, qsizetype from, bool interior)
+{
+	// Équivalent de contains("_" + motif) ou, intérieur, contains("_" + motif + "_")
+	const qsizetype last = tokens.size() - pattern.size() - (interior ? 1 : 0);
+	for (qsizetype i = std::max<qsizetype>(from, 1); i <= last; i++)
+	{
+		if (std::equal(pattern.begin(), pattern.end(), tokens.begin() + i))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+VoiceMatcher::Tokens VoiceMatcher::replaceAll(const Tokens& tokens, const Tokens& from, const Tokens& to, bool interior)
+{
+	qsizetype match = indexOf(tokens, from, 0, interior);
+	if (match < 0 || from.isEmpty())
+	{
+		return tokens;
+	}
+
+	Tokens result;
+	qsizetype pos = 0;
+	while (match >= 0)
+	{
+		result.append(tokens.constData() + pos, match - pos);
+		result.append(to.constData(), to.size());
+		pos = match + from.size();
+		match = indexOf(tokens, from, pos, interior);
+	}
+	result.append(tokens.constData() + pos, tokens.size() - pos);
+	return result;
+}
@@ -0,0 +1,147 @@
+#ifndef VOICEMATCHER_H
+#define VOICEMATCHER_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVarLengthArray>
+
+class PathPool;
+struct VoiceFile;
+
+// Règles de correspondance (remplacements, sous-dossiers, races de repli) compilées une fois
+// sur des tokens internés : un nom "Play_xxx_yyy" devient une suite d'entiers, les voix sont
+// indexées sous cette suite et chaque candidat se résout par une simple recherche dans le hash,
+// sans reconstruire de chaîne. Les voix sont désignées par leur index dans la liste indexée.
+class VoiceMatcher
+{
+public:
+	using Tokens = QVarLengthArray<quint32, 16>;
+
+	// Règles qui ont mené à une correspondance, combinables (suppression de "_alt01" puis race, ...)
+	enum Rule : quint8
+	{
+		ExactRule = 0x01,
+		ReplaceRule = 0x02,
+		SubFolderRule = 0x04,
+		RaceRule = 0x08,
+		FuzzyRule = 0x10
+	};
+
+	struct Match
+	{
+		qsizetype voiceFile = -1;
+		quint8 rules = 0;
+		// Avec RaceRule : index de la race et de la race de remplacement
+		qint16 race = -1;
+		qint16 raceTarget = -1;
+	};
+
+	struct FuzzyMatch
+	{
+		qsizetype voiceFile = -1;
+		float confidence = 0.0f;
+	};
+
+	void compile(const QHash<QString, QString>& replacements, const QStringList& subFolders, const QHash<QString, QVector<QString>>& correspondingRaces);
+	void index(const QList<VoiceFile>& voiceFiles, const PathPool& voicePaths);
+	// Mise à jour d'une seule voix après index(), pour le mode surveillance
+	void insert(quint32 voiceFile, QStringView filePath);
+	void remove(quint32 voiceFile, QStringView filePath);
+
+	// Nom de base d'un txtp (sans "v.txtp") -> index de la voix correspondante, -1 sinon
+	Match find(QStringView baseName) const;
+	// Repli "Sauvage" : même fin de nom après le sexe, sinon même id de réplique (8 caractères),
+	// en préférant le même sexe. La confiance va de 0.4 à 0.9.
+	FuzzyMatch findFuzzy(QStringView baseName) const;
+
+	// Nom lisible d'une substitution, par exemple "high_elf>haut_elfe"
+	QString raceTargetName(int race, int raceTarget) const;
+	// Combinaison de Rule <-> "replace+race", comme dans le rapport de lancement
+	static QString ruleNames(quint8 rules);
+	static quint8 rulesFromNames(QStringView names);
+
+	static QStringView baseName(QStringView filePath);
+	// Chemin d'une VF -> nom d'event attendu : "<...>/Oblivion.esm/imperial/m/x_y.mp3" -> "Play_imperial_m_x_y"
+	static QString voiceName(QStringView filePath);
+
+private:
+	static constexpr quint32 unknownToken = 0xFFFFFFFF;
+
+	struct Replacement
+	{
+		Tokens from;
+		Tokens to;
+		bool interior = false;
+	};
+
+	struct Race
+	{
+		QString name;
+		Tokens tokens;
+		QStringList targetNames;
+		QList<Tokens> targets;
+	};
+
+	struct FuzzyEntry
+	{
+		quint32 voiceFile = 0;
+		quint32 sex = unknownToken;
+		quint32 response = unknownToken;
+	};
+
+	// Hash découpé en lots selon le hash de la clé : chaque lot se construit sur son propre thread
+	template <typename Key, typename Value>
+	struct ShardedHash
+	{
+		QList<QHash<Key, Value>> shards;
+
+		QHash<Key, Value>& shard(const Key& key)
+		{
+			// insert() avant index() : un seul lot, plutôt qu'une division par zéro
+			if (shards.isEmpty())
+			{
+				shards.resize(1);
+			}
+			return shards[qHash(key) % size_t(shards.size())];
+		}
+
+		const Value* find(const Key& key) const
+		{
+			if (shards.isEmpty())
+			{
+				return nullptr;
+			}
+			const QHash<Key, Value>& shard = shards[qHash(key) % size_t(shards.size())];
+			const auto it = shard.constFind(key);
+			return it == shard.constEnd() ? nullptr : &*it;
+		}
+	};
+
+	static FuzzyEntry fuzzyEntry(quint32 voiceFile, const Tokens& tokens, qsizetype sex, qsizetype lineId);
+	quint32 intern(QStringView token);
+	Tokens internAll(QStringView name);
+	bool tokenize(QStringView name, Tokens& tokens) const;
+	void normalize(Tokens& tokens, quint8& rules) const;
+	qsizetype sexIndex(const Tokens& tokens) const;
+	qsizetype lineIdIndex(const Tokens& tokens) const;
+	static qsizetype indexOf(const Tokens& tokens, const Tokens& pattern, qsizetype from, bool interior);
+	static Tokens replaceAll(const Tokens& tokens, const Tokens& from, const Tokens& to, bool interior);
+
+	QStringList tokenStrings;
+	QHash<QStringView, quint32> tokenIds;
+
+	QList<Replacement> replacements;
+	QList<Race> races;
+
+	quint32 maleToken = unknownToken;
+	quint32 femaleToken = unknownToken;
+
+	ShardedHash<Tokens, quint32> voiceFileByTokens;
+	ShardedHash<Tokens, QList<FuzzyEntry>> voiceFilesBySuffix;
+	ShardedHash<quint32, QList<FuzzyEntry>> voiceFilesByLineId;
+};
+
+#endif // VOICEMATCHER_H
@@ -0,0 +1,181 @@
+#include "VoiceWatcher.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+
+namespace
+{
+	// Une copie de centaines de VF arrive en rafale : une seule mise à jour à la fin
+	const int flushDelayMs = 300;
+	const QStringList voiceFilters = QStringList() << "*.mp3" << "*.wem";
+}
+
+VoiceWatcher::VoiceWatcher(QObject* parent)
+	: QObject(parent)
+{
+	flushTimer.setSingleShot(true);
+	flushTimer.setInterval(flushDelayMs);
+	connect(&watcher, &QFileSystemWatcher::directoryChanged, this, &VoiceWatcher::directoryChanged);
+	connect(&watcher, &QFileSystemWatcher::fileChanged, this, &VoiceWatcher::fileChanged);
+	connect(&flushTimer, &QTimer::timeout, this, &VoiceWatcher::flush);
+}
+
+bool VoiceWatcher::start(const QString& folderPath)
+{
+	stop();
+	if (!QDir(folderPath).exists())
+	{
+		return false;
+	}
+	addFolders(folderPath);
+	return isActive();
+}
+
+void VoiceWatcher::stop()
+{
+	flushTimer.stop();
+	changedFolders.clear();
+	if (!watcher.directories().isEmpty())
+	{
+		watcher.removePaths(watcher.directories());
+	}
+	if (!watcher.files().isEmpty())
+	{
+		watcher.removePaths(watcher.files());
+	}
+	watchedFolders.clear();
+	watchedFiles.clear();
+}
+
+QStringList VoiceWatcher::addFolders(const QString& folderPath)
+{
+	QStringList folders;
+	if (!watchedFolders.contains(folderPath))
+	{
+		folders.append(folderPath);
+	}
+	QDirIterator it(folderPath, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+	while (it.hasNext())
+	{
+		const QString subFolderPath = it.next();
+		if (!watchedFolders.contains(subFolderPath))
+		{
+			folders.append(subFolderPath);
+		}
+	}
+	if (folders.isEmpty())
+	{
+		return folders;
+	}
+
+	// addPaths() refuse ce qui est déjà suivi ou a disparu entre-temps
+	const QStringList failed = watcher.addPaths(folders);
+	for (const QString& folder : folders)
+	{
+		if (!failed.contains(folder))
+		{
+			watchedFolders.insert(folder);
+			addFiles(folder);
+		}
+	}
+	return folders;
+}
+
+void VoiceWatcher::addFiles(const QString& folderPath)
+{
+	QStringList files;
+	for (const QString& fileName : QDir(folderPath).entryList(voiceFilters, QDir::Files))
+	{
+		const QString filePath = folderPath + "/" + fileName;
+		if (!watchedFiles.contains(filePath))
+		{
+			files.append(filePath);
+		}
+	}
+	if (files.isEmpty())
+	{
+		return;
+	}
+	const QStringList failed = watcher.addPaths(files);
+	for (const QString& filePath : files)
+	{
+		if (!failed.contains(filePath))
+		{
+			watchedFiles.insert(filePath);
+		}
+	}
+}
+
+void VoiceWatcher::directoryChanged(const QString& folderPath)
+{
+	changedFolders.insert(folderPath);
+	if (QDir(folderPath).exists())
+	{
+		for (const QString& folder : addFolders(folderPath))
+		{
+			changedFolders.insert(folder);
+		}
+		// VF créées ou arrivées par renommage
+		addFiles(folderPath);
+	}
+	else
+	{
+		// Le dossier supprimé ne signale plus rien, ses sous-dossiers non plus
+		const QString prefix = folderPath + "/";
+		for (auto it = watchedFolders.begin(); it != watchedFolders.end();)
+		{
+			if (*it == folderPath || it->startsWith(prefix))
+			{
+				changedFolders.insert(*it);
+				watcher.removePath(*it);
+				it = watchedFolders.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		for (auto it = watchedFiles.begin(); it != watchedFiles.end();)
+		{
+			if (it->startsWith(prefix))
+			{
+				watcher.removePath(*it);
+				it = watchedFiles.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+	flushTimer.start();
+}
+
+void VoiceWatcher::fileChanged(const QString& filePath)
+{
+	// updateVoiceFolders() compare taille et date de chaque VF du dossier
+	changedFolders.insert(QFileInfo(filePath).path());
+	// Remplacée par un renommage, l'ancien fichier n'est plus suivi : la nouvelle VF l'est à
+	// sa place (addPath() ne fait rien si elle l'est encore)
+	if (QFileInfo::exists(filePath))
+	{
+		if (watcher.addPath(filePath))
+		{
+			watchedFiles.insert(filePath);
+		}
+	}
+	else
+	{
+		watcher.removePath(filePath);
+		watchedFiles.remove(filePath);
+	}
+	flushTimer.start();
+}
+
+void VoiceWatcher::flush()
+{
+	const QStringList folders(changedFolders.constBegin(), changedFolders.constEnd());
+	changedFolders.clear();
+	emit foldersChanged(folders);
+}
@@ -0,0 +1,51 @@
+#ifndef VOICEWATCHER_H
+#define VOICEWATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+// Surveillance du dossier des VF (inotify sous Linux, via QFileSystemWatcher) : chaque
+// sous-dossier est suivi pour les créations, suppressions et renommages, et chaque VF pour
+// les réécritures sur place (réenregistrement d'une réplique). Les événements sont regroupés
+// pendant un court délai puis signalés en une fois par foldersChanged(), avec le dossier de
+// chaque VF touchée ; un nouveau sous-dossier est suivi à son tour et signalé avec tout ce
+// qu'il contient déjà. Si le système refuse de suivre autant de fichiers (limite inotify),
+// ceux en trop ne sont vus que par leur dossier.
+class VoiceWatcher : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit VoiceWatcher(QObject* parent = nullptr);
+
+	// Arrête la surveillance précédente ; renvoie false si le dossier ne peut pas être suivi
+	bool start(const QString& folderPath);
+	void stop();
+	bool isActive() const { return !watchedFolders.isEmpty(); }
+
+signals:
+	void foldersChanged(const QStringList& folderPaths);
+
+private slots:
+	void directoryChanged(const QString& folderPath);
+	void fileChanged(const QString& filePath);
+	void flush();
+
+private:
+	// Dossier et tous ses sous-dossiers pas encore suivis ; renvoie ceux ajoutés
+	QStringList addFolders(const QString& folderPath);
+	// VF du dossier pas encore suivies
+	void addFiles(const QString& folderPath);
+
+	QFileSystemWatcher watcher;
+	QSet<QString> watchedFolders;
+	QSet<QString> watchedFiles;
+	QSet<QString> changedFolders;
+	QTimer flushTimer;
+};
+
+#endif // VOICEWATCHER_H
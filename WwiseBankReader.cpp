@@ -0,0 +1,314 @@
+#include "WwiseBankReader.h"
+
+#include <QObject>
+#include <QtEndian>
+
+namespace
+{
+	enum HircType : quint8
+	{
+		HircSound = 2,
+		HircAction = 3,
+		HircEvent = 4
+	};
+
+	const quint16 actionPlay = 0x0403;
+
+	bool readU32(QByteArrayView data, qsizetype pos, quint32& value)
+	{
+		if (pos < 0 || pos + 4 > data.size())
+		{
+			return false;
+		}
+		value = qFromLittleEndian<quint32>(data.data() + pos);
+		return true;
+	}
+
+	bool readU16(QByteArrayView data, qsizetype pos, quint16& value)
+	{
+		if (pos < 0 || pos + 2 > data.size())
+		{
+			return false;
+		}
+		value = qFromLittleEndian<quint16>(data.data() + pos);
+		return true;
+	}
+
+	// Entier à taille variable de Wwise : 7 bits par octet, bit 8 = suite
+	bool readVar(QByteArrayView data, qsizetype& pos, quint32& value)
+	{
+		value = 0;
+		for (int i = 0; i < 5; i++)
+		{
+			if (pos >= data.size())
+			{
+				return false;
+			}
+			const quint8 byte = static_cast<quint8>(data[pos++]);
+			value = (value << 7) | (byte & 0x7F);
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+bool WwiseBankReader::open(const QString& filePath)
+{
+	events.clear();
+	actions.clear();
+	sounds.clear();
+	error.clear();
+
+	file.setFileName(filePath);
+	if (!file.open(QFile::ReadOnly))
+	{
+		error = QObject::tr("Impossible d'ouvrir le fichier");
+		return false;
+	}
+	const uchar* mapped = file.map(0, file.size());
+	if (!mapped)
+	{
+		error = QObject::tr("Impossible de mapper le fichier");
+		return false;
+	}
+	const QByteArrayView data(reinterpret_cast<const char*>(mapped), file.size());
+
+	if (data.startsWith("AKPK"))
+	{
+		return indexPackage(data);
+	}
+	if (data.startsWith("BKHD"))
+	{
+		return indexBank(data);
+	}
+	error = QObject::tr("Ni une soundbank ni un package Wwise");
+	return false;
+}
+
+bool WwiseBankReader::indexPackage(QByteArrayView package)
+{
+	quint32 headerSize = 0, languageMapSize = 0, banksSize = 0, streamsSize = 0;
+	if (!readU32(package, 4, headerSize) || !readU32(package, 12, languageMapSize)
+		|| !readU32(package, 16, banksSize) || !readU32(package, 20, streamsSize))
+	{
+		error = QObject::tr("En-tête AKPK tronqué");
+		return false;
+	}
+
+	// Les packages récents ajoutent la taille de la table des fichiers externes
+	qsizetype tablesPos = 24;
+	if (headerSize != 16 + languageMapSize + banksSize + streamsSize)
+	{
+		tablesPos = 28;
+	}
+
+	const qsizetype banksPos = tablesPos + languageMapSize;
+	quint32 bankCount = 0;
+	if (!readU32(package, banksPos, bankCount))
+	{
+		error = QObject::tr("Table des banks tronquée");
+		return false;
+	}
+
+	for (quint32 i = 0; i < bankCount; i++)
+	{
+		const qsizetype entryPos = banksPos + 4 + qsizetype(i) * 20;
+		quint32 blockSize = 0, fileSize = 0, startBlock = 0;
+		if (!readU32(package, entryPos + 4, blockSize) || !readU32(package, entryPos + 8, fileSize)
+			|| !readU32(package, entryPos + 12, startBlock))
+		{
+			error = QObject::tr("Table des banks tronquée");
+			return false;
+		}
+
+		const qsizetype offset = qsizetype(startBlock) * (blockSize ? blockSize : 1);
+		if (offset + fileSize > package.size())
+		{
+			error = QObject::tr("Bank hors du package");
+			return false;
+		}
+		if (!indexBank(package.sliced(offset, fileSize)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool WwiseBankReader::indexBank(QByteArrayView bank)
+{
+	quint32 version = 0;
+	qsizetype pos = 0;
+	while (pos + 8 <= bank.size())
+	{
+		const QByteArrayView tag = bank.sliced(pos, 4);
+		quint32 size = 0;
+		readU32(bank, pos + 4, size);
+		if (pos + 8 + qsizetype(size) > bank.size())
+		{
+			error = QObject::tr("Chunk tronqué");
+			return false;
+		}
+		const QByteArrayView chunk = bank.sliced(pos + 8, size);
+
+		if (tag == "BKHD")
+		{
+			if (!readU32(chunk, 0, version))
+			{
+				error = QObject::tr("En-tête BKHD tronqué");
+				return false;
+			}
+		}
+		else if (tag == "HIRC")
+		{
+			if (!indexHirc(chunk, version))
+			{
+				return false;
+			}
+		}
+		pos += 8 + size;
+	}
+	return true;
+}
+
+bool WwiseBankReader::indexHirc(QByteArrayView hirc, quint32 version)
+{
+	quint32 count = 0;
+	if (!readU32(hirc, 0, count))
+	{
+		error = QObject::tr("Chunk HIRC tronqué");
+		return false;
+	}
+
+	qsizetype pos = 4;
+	for (quint32 i = 0; i < count; i++)
+	{
+		quint32 size = 0, id = 0;
+		if (pos + 5 > hirc.size() || !readU32(hirc, pos + 1, size) || size < 4
+			|| pos + 5 + qsizetype(size) > hirc.size())
+		{
+			error = QObject::tr("Objet HIRC tronqué");
+			return false;
+		}
+		const quint8 type = static_cast<quint8>(hirc[pos]);
+		readU32(hirc, pos + 5, id);
+		const HircObject object{ version, hirc.sliced(pos + 9, size - 4) };
+
+		switch (type)
+		{
+		case HircSound:
+			sounds.insert(id, object);
+			break;
+		case HircAction:
+			actions.insert(id, object);
+			break;
+		case HircEvent:
+			events.insert(id, object);
+			break;
+		default:
+			break;
+		}
+		pos += 5 + size;
+	}
+	return true;
+}
+
+bool WwiseBankReader::findSound(quint32 eventId, Sound& sound) const
+{
+	const auto event = events.constFind(eventId);
+	if (event == events.constEnd())
+	{
+		return false;
+	}
+
+	qsizetype pos = 0;
+	quint32 actionCount = 0;
+	if (event->version <= 122)
+	{
+		if (!readU32(event->body, pos, actionCount))
+		{
+			return false;
+		}
+		pos += 4;
+	}
+	else if (!readVar(event->body, pos, actionCount))
+	{
+		return false;
+	}
+
+	for (quint32 i = 0; i < actionCount; i++)
+	{
+		quint32 actionId = 0;
+		if (!readU32(event->body, pos + qsizetype(i) * 4, actionId))
+		{
+			return false;
+		}
+		const auto action = actions.constFind(actionId);
+		if (action == actions.constEnd())
+		{
+			continue;
+		}
+
+		quint16 actionType = 0;
+		quint32 targetId = 0;
+		if (!readU16(action->body, 0, actionType) || actionType != actionPlay || !readU32(action->body, 2, targetId))
+		{
+			continue;
+		}
+
+		// Seuls les events qui jouent directement un Sound sont résolus,
+		// les containers (random, switch...) ne sont pas parcourus
+		const auto target = sounds.constFind(targetId);
+		if (target == sounds.constEnd())
+		{
+			continue;
+		}
+
+		// AkBankSourceData : ulPluginID, StreamType (u32 jusqu'à la v88, u8 ensuite), sourceID
+		const qsizetype sourceIdPos = target->version <= 88 ? 8 : 5;
+		if (readU32(target->body, 0, sound.pluginId) && readU32(target->body, sourceIdPos, sound.wemId))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+quint32 WwiseBankReader::hashName(QByteArrayView name)
+{
+	// FNV-1 32 bits sur le nom en minuscules, comme Wwise
+	quint32 hash = 2166136261u;
+	for (const char c : name)
+	{
+		const char lower = (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+		hash *= 16777619u;
+		hash ^= static_cast<quint8>(lower);
+	}
+	return hash;
+}
+
+QString WwiseBankReader::codecName(quint32 pluginId)
+{
+	switch (pluginId >> 16)
+	{
+	case 0x01: return "PCM";
+	case 0x02: return "ADPCM";
+	case 0x03: return "XMA";
+	case 0x04: return "VORBIS";
+	case 0x05: return "WIIADPCM";
+	case 0x07: return "PCMEX";
+	case 0x08: return "EXTERNAL_SOURCE";
+	case 0x09: return "XWMA";
+	case 0x0A: return "AAC";
+	case 0x0B: return "FILE_PACKAGE";
+	case 0x0C: return "ATRAC9";
+	case 0x0D: return "VAG";
+	case 0x11: return "OPUSNX";
+	case 0x13: return "OPUS";
+	case 0x14: return "OPUS_WEM";
+	default: return QString("0x%1").arg(pluginId, 8, 16, QChar('0'));
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef WWISEBANKREADER_H
+#define WWISEBANKREADER_H
+
+#include <QByteArrayView>
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+// Lecture directe des soundbanks (.bnk) et packages (.pck) Wwise.
+// Le fichier est mappé en mémoire et seuls des offsets vers les objets HIRC
+// (Event, Action, Sound) sont indexés : rien n'est copié.
+// Les noms d'events ne sont pas stockés dans les banks (seulement leur hash FNV),
+// il faut donc fournir les noms candidats pour retrouver le wem d'un event.
+class WwiseBankReader
+{
+public:
+	struct Sound
+	{
+		quint32 wemId = 0;
+		quint32 pluginId = 0;
+	};
+
+	bool open(const QString& filePath);
+	QString errorString() const { return error; }
+
+	bool findSound(quint32 eventId, Sound& sound) const;
+	qsizetype eventCount() const { return events.size(); }
+
+	static quint32 hashName(QByteArrayView name);
+	static QString codecName(quint32 pluginId);
+
+private:
+	struct HircObject
+	{
+		quint32 version = 0;
+		QByteArrayView body;
+	};
+
+	bool indexPackage(QByteArrayView package);
+	bool indexBank(QByteArrayView bank);
+	bool indexHirc(QByteArrayView hirc, quint32 version);
+
+	QFile file;
+	QString error;
+
+	QHash<quint32, HircObject> events;
+	QHash<quint32, HircObject> actions;
+	QHash<quint32, HircObject> sounds;
+};
+
+#endif // WWISEBANKREADER_H
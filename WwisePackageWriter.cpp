@@ -0,0 +1,162 @@
+#include "WwisePackageWriter.h"
+
+#include <QObject>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	const quint32 packageVersion = 1;
+	// Toutes les voix sont dans la langue "sfx" (id 0), comme les streams sans langue du jeu
+	const quint32 languageId = 0;
+	const char16_t languageName[] = u"sfx";
+
+	void appendU32(QByteArray& data, quint32 value)
+	{
+		const quint32 littleEndian = qToLittleEndian(value);
+		data.append(reinterpret_cast<const char*>(&littleEndian), sizeof(littleEndian));
+	}
+
+	qint64 alignUp(qint64 offset)
+	{
+		return (offset + WwisePackageWriter::blockSize - 1) / WwisePackageWriter::blockSize * WwisePackageWriter::blockSize;
+	}
+}
+
+qsizetype WwisePackageWriter::addData(qint64 size)
+{
+	dataSizes.append(size);
+	return dataSizes.size() - 1;
+}
+
+void WwisePackageWriter::addStream(quint32 id, qsizetype data)
+{
+	streams.append({ id, data });
+}
+
+bool WwisePackageWriter::open(const QString& filePath)
+{
+	error.clear();
+	writtenData = 0;
+
+	// Le jeu cherche les ids par dichotomie dans la table
+	std::stable_sort(streams.begin(), streams.end(),
+		[](const Stream& left, const Stream& right)
+		{
+			return left.id < right.id;
+		}
+	);
+	streams.erase(std::unique(streams.begin(), streams.end(),
+		[](const Stream& left, const Stream& right)
+		{
+			return left.id == right.id;
+		}
+	), streams.end());
+
+	QByteArray languageMap;
+	appendU32(languageMap, 1);
+	appendU32(languageMap, 4 + 8);
+	appendU32(languageMap, languageId);
+	for (const char16_t c : languageName)
+	{
+		const quint16 littleEndian = qToLittleEndian(quint16(c));
+		languageMap.append(reinterpret_cast<const char*>(&littleEndian), sizeof(littleEndian));
+	}
+	languageMap.append(alignUp(languageMap.size()) - languageMap.size(), '\0');
+	QByteArray banks;
+	appendU32(banks, 0);
+	const qint64 streamsSize = 4 + qint64(streams.size()) * 20;
+
+	// Contenus à la suite de l'en-tête, chacun sur une frontière de bloc
+	dataOffsets.resize(dataSizes.size());
+	qint64 offset = alignUp(24 + languageMap.size() + banks.size() + streamsSize);
+	for (qsizetype i = 0; i < dataSizes.size(); i++)
+	{
+		if (dataSizes[i] < 0 || dataSizes[i] > qint64(UINT32_MAX))
+		{
+			error = QObject::tr("Taille de wem invalide");
+			return false;
+		}
+		dataOffsets[i] = offset;
+		offset = alignUp(offset + dataSizes[i]);
+	}
+	if (offset / blockSize > qint64(UINT32_MAX))
+	{
+		error = QObject::tr("Package trop gros");
+		return false;
+	}
+
+	QByteArray header("AKPK");
+	appendU32(header, quint32(16 + languageMap.size() + banks.size() + streamsSize));
+	appendU32(header, packageVersion);
+	appendU32(header, quint32(languageMap.size()));
+	appendU32(header, quint32(banks.size()));
+	appendU32(header, quint32(streamsSize));
+	header += languageMap;
+	header += banks;
+	appendU32(header, quint32(streams.size()));
+	for (const Stream& stream : streams)
+	{
+		appendU32(header, stream.id);
+		appendU32(header, blockSize);
+		appendU32(header, quint32(dataSizes[stream.data]));
+		appendU32(header, quint32(dataOffsets[stream.data] / blockSize));
+		appendU32(header, languageId);
+	}
+
+	file.setFileName(filePath);
+	if (!file.open(QFile::WriteOnly))
+	{
+		error = file.errorString();
+		return false;
+	}
+	if (file.write(header) != header.size() || !writePadding(alignUp(header.size()) - header.size()))
+	{
+		error = file.errorString();
+		file.cancelWriting();
+		return false;
+	}
+	return true;
+}
+
+bool WwisePackageWriter::writeData(QByteArrayView data)
+{
+	if (writtenData >= dataSizes.size() || data.size() != dataSizes[writtenData])
+	{
+		error = QObject::tr("Contenu différent de celui déclaré");
+		file.cancelWriting();
+		return false;
+	}
+	if (file.write(data.data(), data.size()) != data.size() || !writePadding(alignUp(data.size()) - data.size()))
+	{
+		error = file.errorString();
+		file.cancelWriting();
+		return false;
+	}
+	writtenData++;
+	return true;
+}
+
+bool WwisePackageWriter::commit()
+{
+	if (writtenData != dataSizes.size())
+	{
+		error = QObject::tr("Package incomplet");
+		file.cancelWriting();
+		return false;
+	}
+	if (!file.commit())
+	{
+		error = file.errorString();
+		return false;
+	}
+	return true;
+}
+
+bool WwisePackageWriter::writePadding(qint64 size)
+{
+	static const char zeros[blockSize] = {};
+	return size == 0 || file.write(zeros, size) == size;
+}
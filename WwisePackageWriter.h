@@ -0,0 +1,48 @@
+#ifndef WWISEPACKAGEWRITER_H
+#define WWISEPACKAGEWRITER_H
+
+#include <QByteArrayView>
+#include <QList>
+#include <QSaveFile>
+#include <QString>
+
+// Écriture d'un package Wwise (.pck) qui ne contient que des fichiers stream (<id>.wem) :
+// en-tête AKPK, table des streams triée par id, puis les contenus alignés sur blockSize,
+// ce qui permet de mapper le package et d'y lire chaque wem sans copie.
+// Tout est déclaré avant open() ; les contenus sont ensuite écrits d'un seul trait,
+// dans l'ordre des addData(). Le package n'apparaît qu'au commit().
+class WwisePackageWriter
+{
+public:
+	static constexpr quint32 blockSize = 16;
+
+	// Déclare un contenu de size octets et renvoie son numéro pour addStream()
+	qsizetype addData(qint64 size);
+	// Plusieurs ids peuvent partager le même contenu ; un id déjà ajouté est ignoré
+	void addStream(quint32 id, qsizetype data);
+
+	bool open(const QString& filePath);
+	// Un appel par contenu, dans l'ordre des addData() : la taille doit être celle déclarée
+	bool writeData(QByteArrayView data);
+	bool commit();
+	QString errorString() const { return error; }
+
+private:
+	struct Stream
+	{
+		quint32 id = 0;
+		qsizetype data = 0;
+	};
+
+	bool writePadding(qint64 size);
+
+	QSaveFile file;
+	QString error;
+
+	QList<qint64> dataSizes;
+	QList<qint64> dataOffsets;
+	QList<Stream> streams;
+	qsizetype writtenData = 0;
+};
+
+#endif // WWISEPACKAGEWRITER_H
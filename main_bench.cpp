@@ -0,0 +1,227 @@
+#include "Frenchiser.h"
+#include "Trace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QtConcurrent/QtConcurrent>
+
+#include <iterator>
+
+// Banc d'essai : génère une arborescence synthétique (txtp de Wwiser + VF rangées par
+// <plugin>.esm/<race>/<sexe>/) puis chronomètre les trois étapes dessus.
+namespace
+{
+	enum ExitCode
+	{
+		Success = 0,
+		InvalidArguments = 1,
+		GenerationFailed = 2
+	};
+
+	struct Throughput
+	{
+		QString stage;
+		qint64 wallMs = 0;
+		qint64 files = 0;
+		qint64 bytes = 0;
+	};
+
+	bool writeFile(const QString& filePath, const QByteArray& content)
+	{
+		QFile file(filePath);
+		return file.open(QFile::WriteOnly) && file.write(content) == content.size();
+	}
+
+	bool generateCorpus(const QString& folder, int fileCount, int voiceSize, quint32 seed, const QHash<QString, QVector<QString>>& correspondingRaces)
+	{
+		static const char* const topics[] = { "greeting", "goodbye", "rumors", "hello", "attack", "flee", "idlechatter", "service" };
+		static const char* const codecs[] = { "VORBIS", "VORBIS", "VORBIS", "PCM", "OPUS" };
+		QRandomGenerator random(seed);
+		const QStringList races = correspondingRaces.keys();
+		const QString txtpFolder = folder + "/txtp";
+		const QString voiceFolder = folder + "/vf";
+
+		QByteArray voiceContent(voiceSize, '\0');
+		for (int i = 0; i < fileCount; i++)
+		{
+			const QString& race = races[random.bounded(int(races.size()))];
+			const QVector<QString>& targets = correspondingRaces[race];
+			const QString targetRace = QString(targets[random.bounded(int(targets.size()))]).replace(' ', '_');
+			const QString sex = random.bounded(2) ? "m" : "f";
+			const QString quest = QString("mq%1").arg(random.bounded(200), 3, 10, QChar('0'));
+			const QString topic = topics[random.bounded(int(std::size(topics)))];
+			const QString lineId = QString("%1").arg(0x00100000 + i, 8, 16, QChar('0'));
+			const QString response = QString::number(1 + random.bounded(3));
+			const QString tail = quest + "_" + topic + "_" + lineId + "_" + response;
+
+			// Variantes que la correspondance doit savoir défaire : sous-dossier, suffixe _alt01
+			QString txtpName = "Play_" + race + "_" + sex + "_" + tail;
+			const int variant = random.bounded(100);
+			if (variant < 5)
+			{
+				txtpName = "Play_" + race + "_altvoice_" + sex + "_" + tail;
+			}
+			else if (variant < 8)
+			{
+				txtpName += "_alt01";
+			}
+
+			const QString txtpSubFolder = txtpFolder + "/" + quest;
+			QDir().mkpath(txtpSubFolder);
+			const QByteArray txtp = "wem/" + QByteArray::number(100000000 + i) + ".wem #i\n"
+				"#  " + txtpName.toUtf8() + "\n"
+				"# - ulPluginID: 0x00040001 [" + codecs[random.bounded(int(std::size(codecs)))] + "]\n";
+			if (!writeFile(txtpSubFolder + "/" + txtpName + "v.txtp", txtp))
+			{
+				return false;
+			}
+
+			// Environ 10 % des répliques n'ont pas de VF
+			if (random.bounded(10) == 0)
+			{
+				continue;
+			}
+			const QString voiceSubFolder = voiceFolder + "/Oblivion.esm/" + targetRace + "/" + sex;
+			QDir().mkpath(voiceSubFolder);
+			voiceContent.replace(0, 4, reinterpret_cast<const char*>(&i), 4);
+			if (!writeFile(voiceSubFolder + "/" + tail + ".mp3", voiceContent))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void printThroughput(QTextStream& out, const Throughput& throughput)
+	{
+		const double seconds = qMax<qint64>(throughput.wallMs, 1) / 1000.0;
+		out << throughput.stage << "\t" << throughput.wallMs << " ms\t"
+			<< QString::number(throughput.files / seconds, 'f', 0) << " fichiers/s\t"
+			<< QString::number(throughput.bytes / (1024.0 * 1024.0) / seconds, 'f', 1) << " Mo/s" << Qt::endl;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QCoreApplication::setApplicationName("OblivionFrenchiserBench");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QCoreApplication::translate("main", "Génère un corpus synthétique et mesure le débit de chaque étape."));
+	parser.addHelpOption();
+	QCommandLineOption generateOption("generate", QCoreApplication::translate("main", "Génère d'abord un corpus de <n> txtp (10000 à 1000000) dans le dossier."), "n");
+	parser.addOption(generateOption);
+	QCommandLineOption voiceSizeOption("voice-size", QCoreApplication::translate("main", "Taille de chaque VF générée, en octets."), "octets", "4096");
+	parser.addOption(voiceSizeOption);
+	QCommandLineOption seedOption("seed", QCoreApplication::translate("main", "Graine du générateur."), "graine", "1");
+	parser.addOption(seedOption);
+	QCommandLineOption runsOption("runs", QCoreApplication::translate("main", "Nombre de passes mesurées."), "n", "3");
+	parser.addOption(runsOption);
+	QCommandLineOption strategyOption("strategy", QCoreApplication::translate("main", "Méthode d'écriture des sorties : auto, hardlink, reflink, kernel ou copy."), "méthode", "auto");
+	parser.addOption(strategyOption);
+	QCommandLineOption copyThreadsOption("copy-threads", QCoreApplication::translate("main", "Nombre de copies simultanées ; 0 pour l'ajustement automatique."), "n", "0");
+	parser.addOption(copyThreadsOption);
+	QCommandLineOption traceOption("trace", QCoreApplication::translate("main", "Écrit la trace de la dernière passe dans logs/trace.json."));
+	parser.addOption(traceOption);
+	QCommandLineOption traceSampleOption("trace-sample", QCoreApplication::translate("main", "Avec --trace : détaille un fichier sur <n> par thread."), "n", "64");
+	parser.addOption(traceSampleOption);
+	parser.addPositionalArgument("dossier", QCoreApplication::translate("main", "Dossier du corpus (sous-dossiers txtp, vf et sortie)."));
+	parser.process(a);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	const QStringList args = parser.positionalArguments();
+	const FileMaterializer::Strategy strategy = FileMaterializer::strategyFromName(parser.value(strategyOption));
+	if (args.size() != 1 || strategy == FileMaterializer::StrategyCount)
+	{
+		err << parser.helpText();
+		return InvalidArguments;
+	}
+
+	const QString folder = QDir::cleanPath(args[0]);
+	const QString txtpFolder = folder + "/txtp";
+	const QString voiceFolder = folder + "/vf";
+	const QString outputFolder = folder + "/sortie";
+
+	if (parser.isSet(generateOption))
+	{
+		const int fileCount = parser.value(generateOption).toInt();
+		QDir(txtpFolder).removeRecursively();
+		QDir(voiceFolder).removeRecursively();
+		QElapsedTimer timer;
+		timer.start();
+		Frenchiser frenchiser;
+		if (fileCount <= 0 || !generateCorpus(folder, fileCount, qMax(4, parser.value(voiceSizeOption).toInt()), parser.value(seedOption).toUInt(), frenchiser.getCorrespondingRaces()))
+		{
+			err << QCoreApplication::translate("main", "Impossible de générer le corpus dans ") << folder << Qt::endl;
+			return GenerationFailed;
+		}
+		out << QCoreApplication::translate("main", "Corpus généré en ") << timer.elapsed() << " ms" << Qt::endl;
+	}
+
+	QDir::current().mkdir("logs");
+	const int runs = qMax(1, parser.value(runsOption).toInt());
+	for (int run = 1; run <= runs; run++)
+	{
+		// Moteur neuf et sans cache : chaque passe refait tout le travail
+		Frenchiser frenchiser;
+		Frenchiser::Options options;
+		options.outputStrategy = strategy;
+		options.copyThreads = parser.value(copyThreadsOption).toInt();
+		frenchiser.setOptions(options);
+		QDir(outputFolder).removeRecursively();
+		QDir().mkpath(outputFolder);
+		if (parser.isSet(traceOption))
+		{
+			// Chaque passe repart de tampons vides : logs/trace.json garde la dernière
+			Trace::start(parser.value(traceSampleOption).toInt());
+		}
+
+		QList<WemFile> scannedWemFiles = frenchiser.s1ProcessBankFolder(txtpFolder);
+		scannedWemFiles += frenchiser.s1ProcessFolder(txtpFolder);
+		frenchiser.setWemFiles(std::move(scannedWemFiles));
+		frenchiser.setVoiceFiles(frenchiser.s2ProcessVoiceFolder(voiceFolder));
+
+		const QList<WemFile>& wemFiles = frenchiser.getWemFiles();
+		frenchiser.getRunReport().begin(RunReport::S3Match);
+		frenchiser.setMatchingFiles(QtConcurrent::blockingMapped<QList<MatchingFile>>(wemFiles.constBegin(), wemFiles.constEnd(),
+			[&frenchiser](const WemFile& wemFile)
+			{
+				return frenchiser.s3ProcessVoice(wemFile);
+			}
+		));
+		frenchiser.getRunReport().end(RunReport::S3Match);
+
+		frenchiser.planOutputs();
+		const QList<OutputGroup>& outputGroups = frenchiser.getOutputGroups();
+		frenchiser.resetReplaceCounts();
+		frenchiser.getRunReport().begin(RunReport::S3Copy);
+		frenchiser.replaceVoices(outputFolder);
+		frenchiser.getRunReport().end(RunReport::S3Copy);
+		frenchiser.writeRunReport();
+
+		const RunReport& runReport = frenchiser.getRunReport();
+		const qint64 txtpCount = wemFiles.size() + frenchiser.getInvalidWemFiles().size();
+		const qint64 outputCount = frenchiser.getReplaceCount(Frenchiser::Copied) + frenchiser.getReplaceCount(Frenchiser::Updated);
+		out << QCoreApplication::translate("main", "Passe ") << run << "/" << runs << Qt::endl;
+		printThroughput(out, { "s1 scan ", runReport.getTiming(RunReport::S1Scan).wallMs, txtpCount, frenchiser.getTxtpByteCount() });
+		printThroughput(out, { "s1 index", runReport.getTiming(RunReport::S1Index).wallMs, txtpCount, 0 });
+		printThroughput(out, { "s2 scan ", runReport.getTiming(RunReport::S2Scan).wallMs, frenchiser.getVoiceFiles().size(), frenchiser.getVoiceByteCount() });
+		printThroughput(out, { "s2 index", runReport.getTiming(RunReport::S2Index).wallMs, frenchiser.getVoiceFiles().size(), 0 });
+		printThroughput(out, { "s3 match", runReport.getTiming(RunReport::S3Match).wallMs, wemFiles.size(), 0 });
+		printThroughput(out, { "s3 plan ", runReport.getTiming(RunReport::S3Plan).wallMs, outputGroups.size(), 0 });
+		printThroughput(out, { "s3 copie", runReport.getTiming(RunReport::S3Copy).wallMs, outputCount, frenchiser.getWrittenByteCount() });
+		const CopyScheduler::Stats& copyStats = frenchiser.getCopyStats();
+		out << QCoreApplication::translate("main", "  threads de copie : ") << copyStats.initialThreads << " -> " << copyStats.finalThreads
+			<< " (" << copyStats.minThreads << "-" << copyStats.maxThreads << QCoreApplication::translate("main", "), meilleur : ")
+			<< copyStats.bestThreads << " @ " << QString::number(copyStats.bestMbPerSecond, 'f', 1) << " Mo/s" << Qt::endl;
+	}
+
+	return Success;
+}
@@ -0,0 +1,304 @@
+#include "Frenchiser.h"
+#include "Trace.h"
+#include "VoiceWatcher.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QSettings>
+#include <QTextStream>
+#include <QtConcurrent/QtConcurrent>
+
+enum ExitCode
+{
+	Success = 0,
+	InvalidArguments = 1,
+	InputFolderNotFound = 2,
+	OutputFolderNotFound = 3,
+	CopyFailed = 4,
+	PlanFailed = 5
+};
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QCoreApplication::setApplicationName("OblivionFrenchiserCli");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QCoreApplication::translate("main", "Remplace les voix anglaises d'Oblivion Remastered par les voix françaises."));
+	parser.addHelpOption();
+	QCommandLineOption noCacheOption("no-cache", QCoreApplication::translate("main", "Ignore le cache d'analyse et réanalyse tous les fichiers."));
+	parser.addOption(noCacheOption);
+	QCommandLineOption syncOption("sync", QCoreApplication::translate("main", "Supprime du dossier de sortie les <id>.wem qui ne correspondent plus à aucune voix."));
+	parser.addOption(syncOption);
+	QCommandLineOption strategyOption("strategy", QCoreApplication::translate("main", "Méthode d'écriture des sorties : auto, hardlink, reflink, kernel ou copy."), "méthode", "auto");
+	parser.addOption(strategyOption);
+	QCommandLineOption copyThreadsOption("copy-threads", QCoreApplication::translate("main", "Nombre de copies simultanées ; 0 (par défaut) l'ajuste pendant la copie selon le débit mesuré."), "n", "0");
+	parser.addOption(copyThreadsOption);
+	QCommandLineOption syncEachOption("sync-each", QCoreApplication::translate("main", "Écrit chaque sortie sur le disque (fsync) avant de la renommer, au lieu de le faire par lots de journal : plus sûr en mode surveillance, mais bien plus lent."));
+	parser.addOption(syncEachOption);
+	QCommandLineOption fuzzyOption("fuzzy", QCoreApplication::translate("main", "Cherche une réplique proche pour les voix introuvables (voir logs/fuzzyFiles.log)."));
+	parser.addOption(fuzzyOption);
+	QCommandLineOption skipCodecMismatchOption("skip-codec-mismatch", QCoreApplication::translate("main", "Ne copie pas les voix dont le format ne correspond pas au codec du wem (voir logs/codecMismatches.log)."));
+	parser.addOption(skipCodecMismatchOption);
+	QCommandLineOption packOption("pack", QCoreApplication::translate("main", "Écrit toutes les sorties dans un seul package Wwise <sortie>/OblivionFrenchiser.pck au lieu d'un <id>.wem chacune."));
+	parser.addOption(packOption);
+	QCommandLineOption watchOption("watch", QCoreApplication::translate("main", "Après le remplacement, surveille le dossier VF et ne refait que ce qui dépend des voix ajoutées, modifiées ou supprimées (Ctrl+C pour arrêter)."));
+	parser.addOption(watchOption);
+	QCommandLineOption traceOption("trace", QCoreApplication::translate("main", "Écrit une trace au format Chrome dans logs/trace.json (à ouvrir dans ui.perfetto.dev ou chrome://tracing)."));
+	parser.addOption(traceOption);
+	QCommandLineOption traceSampleOption("trace-sample", QCoreApplication::translate("main", "Avec --trace : détaille un fichier sur <n> par thread (1 pour tous)."), "n", "64");
+	parser.addOption(traceSampleOption);
+	QCommandLineOption restartOption("restart", QCoreApplication::translate("main", "Ignore le journal d'une copie interrompue vers ce dossier et revérifie toutes les sorties."));
+	parser.addOption(restartOption);
+	QCommandLineOption planOption("plan", QCoreApplication::translate("main", "Écrit le plan de remplacement dans <fichier> sans rien copier (pas de dossier de sortie)."), "fichier");
+	parser.addOption(planOption);
+	QCommandLineOption applyOption("apply", QCoreApplication::translate("main", "Applique un plan écrit par --plan, sans analyse ni correspondance (seul le dossier de sortie est attendu)."), "fichier");
+	parser.addOption(applyOption);
+	QCommandLineOption voiceFolderOption("voice-folder", QCoreApplication::translate("main", "Avec --apply : dossier des VF sur cette machine, si ce n'est plus celui du plan."), "dossier");
+	parser.addOption(voiceFolderOption);
+	parser.addPositionalArgument("txtp", QCoreApplication::translate("main", "Dossier des fichiers txtp, ou des .bnk/.pck avec leur wwnames.txt."));
+	parser.addPositionalArgument("vf", QCoreApplication::translate("main", "Dossier des fichiers VF."));
+	parser.addPositionalArgument("sortie", QCoreApplication::translate("main", "Dossier de sortie."));
+	parser.process(a);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	const QStringList args = parser.positionalArguments();
+	const bool planOnly = parser.isSet(planOption);
+	const bool applyPlan = parser.isSet(applyOption);
+	const bool watch = parser.isSet(watchOption);
+	if ((planOnly && applyPlan) || (watch && (planOnly || applyPlan)) || args.size() != (applyPlan ? 1 : planOnly ? 2 : 3))
+	{
+		err << parser.helpText();
+		return InvalidArguments;
+	}
+
+	const FileMaterializer::Strategy strategy = FileMaterializer::strategyFromName(parser.value(strategyOption));
+	if (strategy == FileMaterializer::StrategyCount)
+	{
+		err << QCoreApplication::translate("main", "Méthode inconnue : ") << parser.value(strategyOption) << Qt::endl;
+		return InvalidArguments;
+	}
+
+	const QString txtpFolder = applyPlan ? QString() : QDir::cleanPath(args[0]);
+	const QString voiceFolder = applyPlan ? QString() : QDir::cleanPath(args[1]);
+	const QString outputFolder = planOnly ? QString() : QDir::cleanPath(args.last());
+	if (!applyPlan)
+	{
+		for (const QString& inputFolder : { txtpFolder, voiceFolder })
+		{
+			if (!QDir(inputFolder).exists())
+			{
+				err << QCoreApplication::translate("main", "Le dossier d'entrée n'existe pas : ") << inputFolder << Qt::endl;
+				return InputFolderNotFound;
+			}
+		}
+	}
+	if (!planOnly && !QDir(outputFolder).exists())
+	{
+		err << QCoreApplication::translate("main", "Le dossier de sortie n'existe pas : ") << outputFolder << Qt::endl;
+		return OutputFolderNotFound;
+	}
+
+	QDir::current().mkdir("logs");
+	if (parser.isSet(traceOption))
+	{
+		Trace::start(parser.value(traceSampleOption).toInt());
+	}
+
+	Frenchiser frenchiser;
+	Frenchiser::Options options;
+	options.fuzzyMatching = parser.isSet(fuzzyOption);
+	options.skipCodecMismatches = parser.isSet(skipCodecMismatchOption);
+	options.outputStrategy = strategy;
+	options.copyThreads = parser.value(copyThreadsOption).toInt();
+	options.packedOutput = parser.isSet(packOption);
+	options.syncEachOutput = parser.isSet(syncEachOption);
+	frenchiser.setOptions(options);
+	QFuture<void> reportFuture;
+	if (applyPlan)
+	{
+		// Ni analyse ni correspondance : tout vient du plan, il ne reste que la copie
+		if (!frenchiser.loadPlan(parser.value(applyOption), QDir::cleanPath(parser.value(voiceFolderOption))))
+		{
+			err << QCoreApplication::translate("main", "Plan illisible : ") << parser.value(applyOption) << Qt::endl;
+			return PlanFailed;
+		}
+		frenchiser.writeStalePlanLog();
+		out << QCoreApplication::translate("main", "Sorties du plan : ") << frenchiser.getMatchingFiles().size() << Qt::endl;
+		if (!frenchiser.getStalePlanSources().isEmpty())
+		{
+			err << QCoreApplication::translate("main", "VF modifiées depuis le plan, non copiées : ") << frenchiser.getStalePlanSources().size()
+				<< QCoreApplication::translate("main", " (voir logs/stalePlanSources.log)") << Qt::endl;
+		}
+	}
+	else
+	{
+		if (!parser.isSet(noCacheOption))
+		{
+			QSettings settings("Manicorp", "OblivionVoiceFrenchiser");
+			frenchiser.loadCaches(Frenchiser::defaultCacheFolder(settings));
+		}
+
+		// Les étapes 1 et 2 ne partagent ni données ni cache : l'analyse des txtp tourne à côté de l'étape 2.
+		// setWemFiles() et setVoiceFiles() touchent toutes deux aux correspondances : ce thread les fait à la suite
+		QFuture<QList<WemFile>> s1Future = QtConcurrent::run(
+			[&frenchiser, &txtpFolder]()
+			{
+				// Deux instructions : les banks d'abord, toujours dans le même ordre
+				QList<WemFile> wemFiles = frenchiser.s1ProcessBankFolder(txtpFolder);
+				wemFiles += frenchiser.s1ProcessFolder(txtpFolder);
+				frenchiser.saveTxtpCache();
+				return wemFiles;
+			}
+		);
+
+		frenchiser.setVoiceFiles(frenchiser.s2ProcessVoiceFolder(voiceFolder));
+		frenchiser.writeFrenchFilesLog(voiceFolder);
+		frenchiser.saveVoiceCache();
+		frenchiser.setWemFiles(s1Future.result());
+		frenchiser.writeTxtpErrorsLog();
+
+		out << QCoreApplication::translate("main", "Fichiers txtp : ") << frenchiser.getWemFiles().size() << Qt::endl;
+		if (!frenchiser.getInvalidWemFiles().isEmpty())
+		{
+			err << QCoreApplication::translate("main", "Fichiers txtp invalides : ") << frenchiser.getInvalidWemFiles().size() << Qt::endl;
+		}
+		out << QCoreApplication::translate("main", "Fichiers VF : ") << frenchiser.getVoiceFiles().size() << Qt::endl;
+
+		const QList<WemFile>& wemFiles = frenchiser.getWemFiles();
+		frenchiser.getRunReport().begin(RunReport::S3Match);
+		frenchiser.setMatchingFiles(QtConcurrent::blockingMapped<QList<MatchingFile>>(wemFiles.constBegin(), wemFiles.constEnd(),
+			[&frenchiser](const WemFile& wemFile)
+			{
+				return frenchiser.s3ProcessVoice(wemFile);
+			}
+		));
+		frenchiser.getRunReport().end(RunReport::S3Match);
+		if (frenchiser.getCodecMismatchCount() > 0)
+		{
+			err << QCoreApplication::translate("main", "Formats incompatibles : ") << frenchiser.getCodecMismatchCount()
+				<< (parser.isSet(skipCodecMismatchOption) ? QCoreApplication::translate("main", " (ignorés)") : QCoreApplication::translate("main", " (voir logs/codecMismatches.log)")) << Qt::endl;
+		}
+		reportFuture = QtConcurrent::run(&Frenchiser::writeMatchingLogs, &frenchiser);
+
+		frenchiser.planOutputs();
+		if (planOnly)
+		{
+			const bool written = frenchiser.writePlan(parser.value(planOption), voiceFolder);
+			reportFuture.waitForFinished();
+			frenchiser.writeRunReport();
+			if (!written)
+			{
+				err << QCoreApplication::translate("main", "Impossible d'écrire le plan : ") << parser.value(planOption) << Qt::endl;
+				return PlanFailed;
+			}
+			out << QCoreApplication::translate("main", "Plan écrit : ") << parser.value(planOption) << Qt::endl;
+			return Success;
+		}
+	}
+
+	frenchiser.resetReplaceCounts();
+	frenchiser.getRunReport().begin(RunReport::S3Copy);
+	if (options.packedOutput)
+	{
+		if (!frenchiser.writePackage(Frenchiser::packagePath(outputFolder)))
+		{
+			err << QCoreApplication::translate("main", "Impossible d'écrire le package : ") << Frenchiser::packagePath(outputFolder)
+				<< " (" << frenchiser.getPackageError() << ")" << Qt::endl;
+		}
+	}
+	else
+	{
+		// Par défaut, une copie interrompue de ce même plan reprend où elle s'était arrêtée
+		const bool resume = !parser.isSet(restartOption);
+		const qsizetype resumableCount = resume ? frenchiser.getResumableCount(outputFolder) : 0;
+		if (resumableCount > 0)
+		{
+			out << QCoreApplication::translate("main", "Reprise d'une copie interrompue : ") << resumableCount
+				<< QCoreApplication::translate("main", " sorties déjà écrites") << Qt::endl;
+		}
+		frenchiser.replaceVoices(outputFolder, resume);
+	}
+
+	frenchiser.getRunReport().end(RunReport::S3Copy);
+	reportFuture.waitForFinished();
+	frenchiser.writeRunReport();
+
+	int removed = 0;
+	if (parser.isSet(syncOption))
+	{
+		removed = frenchiser.removeStaleOutputs(outputFolder);
+	}
+
+	out << QCoreApplication::translate("main", "Copiés : ") << frenchiser.getReplaceCount(Frenchiser::Copied) << Qt::endl;
+	out << QCoreApplication::translate("main", "Mis à jour : ") << frenchiser.getReplaceCount(Frenchiser::Updated) << Qt::endl;
+	out << QCoreApplication::translate("main", "Inchangés : ") << frenchiser.getReplaceCount(Frenchiser::Unchanged) << Qt::endl;
+	out << QCoreApplication::translate("main", "Supprimés : ") << removed << Qt::endl;
+	if (frenchiser.getResumedCount() > 0)
+	{
+		out << QCoreApplication::translate("main", "Déjà écrits avant l'interruption : ") << frenchiser.getResumedCount() << Qt::endl;
+	}
+	for (int i = FileMaterializer::Hardlink; i < FileMaterializer::StrategyCount; i++)
+	{
+		const int count = frenchiser.getMaterializer().getCount(FileMaterializer::Strategy(i));
+		if (count > 0)
+		{
+			out << "  " << FileMaterializer::strategyName(FileMaterializer::Strategy(i)) << " : " << count << Qt::endl;
+		}
+	}
+	const CopyScheduler::Stats& copyStats = frenchiser.getCopyStats();
+	if (copyStats.items > 0)
+	{
+		out << QCoreApplication::translate("main", "Copies simultanées : ") << copyStats.minThreads << "-" << copyStats.maxThreads
+			<< QCoreApplication::translate("main", ", meilleur débit ") << QString::number(copyStats.bestMbPerSecond, 'f', 1)
+			<< QCoreApplication::translate("main", " Mo/s à ") << copyStats.bestThreads << Qt::endl;
+	}
+	out << QCoreApplication::translate("main", "Doublons dédupliqués : ") << frenchiser.getDedupFileCount()
+		<< " (" << frenchiser.getDedupByteCount() << QCoreApplication::translate("main", " octets économisés)") << Qt::endl;
+	const int failed = frenchiser.getReplaceCount(Frenchiser::ReplaceFailed);
+	if (failed > 0)
+	{
+		err << QCoreApplication::translate("main", "Copies échouées : ") << failed << Qt::endl;
+		return CopyFailed;
+	}
+
+	if (watch)
+	{
+		VoiceWatcher voiceWatcher;
+		if (!voiceWatcher.start(voiceFolder))
+		{
+			err << QCoreApplication::translate("main", "Impossible de surveiller : ") << voiceFolder << Qt::endl;
+			return InputFolderNotFound;
+		}
+		const bool sync = parser.isSet(syncOption);
+		QObject::connect(&voiceWatcher, &VoiceWatcher::foldersChanged, &voiceWatcher,
+			[&frenchiser, &out, &err, &outputFolder, &voiceFolder, sync](const QStringList& folderPaths)
+			{
+				frenchiser.resetReplaceCounts();
+				const Frenchiser::WatchUpdate update = frenchiser.updateVoiceFolders(folderPaths, outputFolder, sync);
+				if (update.voiceFileCount > 0)
+				{
+					// Logs et rapport décrivent l'état après cette mise à jour, pas le premier lancement
+					frenchiser.writeFrenchFilesLog(voiceFolder);
+					frenchiser.writeMatchingLogs();
+					frenchiser.writeRunReport();
+				}
+				out << QCoreApplication::translate("main", "VF changées : ") << update.voiceFileCount
+					<< QCoreApplication::translate("main", ", voix revues : ") << update.wemFileCount
+					<< QCoreApplication::translate("main", ", écrites : ") << frenchiser.getReplaceCount(Frenchiser::Copied) + frenchiser.getReplaceCount(Frenchiser::Updated)
+					<< QCoreApplication::translate("main", ", supprimées : ") << update.removedCount << Qt::endl;
+				if (frenchiser.getReplaceCount(Frenchiser::ReplaceFailed) > 0)
+				{
+					err << QCoreApplication::translate("main", "Copies échouées : ") << frenchiser.getReplaceCount(Frenchiser::ReplaceFailed) << Qt::endl;
+				}
+			}
+		);
+		out << QCoreApplication::translate("main", "Surveillance de ") << voiceFolder << Qt::endl;
+		return a.exec();
+	}
+
+	return Success;
+}